@@ -8,22 +8,43 @@
 #define USE_UART_INTERRUPTS (1)
 
 #define UART_OVERSAMPLE (16)
+#define UART_MIN_OSR (4)
+#define UART_MAX_OSR (32)
+#define UART_MAX_SBR (8191)
 #define BUS_CLOCK 			(24e6)
 
+#define UART0_BAUD_RATE (115200) // up to UART0 clock/4, e.g. 1000000 or 3000000 at 48 MHz
+
 
 extern char RMC_Speed[16];
 extern char RMC_Track[16];
 extern char VHW_Speed[16];
 extern char VHW_Track[16];
 
+#define UART_RX_ERROR_MASK (UART0_S1_OR_MASK | UART0_S1_NF_MASK | UART0_S1_FE_MASK | UART0_S1_PF_MASK)
+
+typedef struct {
+	unsigned int Overrun; // hardware overrun: byte lost before the ISR read D
+	unsigned int Noise;
+	unsigned int Framing;
+	unsigned int Parity;
+} UART_ERRORS_T;
+
 extern Q_T TxQ, RxQ;
 extern int volatile Buffer_State;
 
 void Init_UART0(uint32_t baud_rate);
+uint32_t Get_UART0_Clock(void);
+uint32_t Get_UART0_Baud(void);
+int32_t Get_UART0_Baud_Error_ppm(void);
 
 void Send_String(uint8_t * str);
+void Send_Char(uint8_t c);
 uint32_t Get_Num_Rx_Chars_Available(void);
 uint8_t	Get_Char(void);
+void Get_UART_Stats(UART_ERRORS_T * errors, Q_STATS_T * rx, Q_STATS_T * tx);
+void Clear_UART_Stats(void);
+void Print_UART_Stats(void);
 
 extern Q_T Tx_Data, Rx_Data;
 
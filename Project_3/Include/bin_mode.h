@@ -0,0 +1,41 @@
+#ifndef BIN_MODE_H
+#define BIN_MODE_H
+
+#include <stdint.h>
+
+// Set to 1 to run Phase 3 with the binary protocol instead of the text one
+#define USE_BINARY_PROTOCOL (0)
+
+// Frame layout (before COBS encoding):
+//   seq, status, count, count * record, CRC16 (big-endian, over all preceding bytes)
+// Request record:  STW, HDG, SOG, TRK as little-endian IEEE floats
+// Response record: cspd, cang as little-endian IEEE floats
+#define BIN_HEADER_SIZE (3)
+#define BIN_CRC_SIZE (2)
+#define BIN_REQ_RECORD_SIZE (16)
+#define BIN_RSP_RECORD_SIZE (8)
+#define BIN_MAX_RECORDS (15) // largest request that fits in one COBS block, FRAME_MAX_DATA
+
+#define BIN_REQ_MAX_SIZE (BIN_HEADER_SIZE + BIN_MAX_RECORDS*BIN_REQ_RECORD_SIZE + BIN_CRC_SIZE)
+#define BIN_RSP_MAX_SIZE (BIN_HEADER_SIZE + BIN_MAX_RECORDS*BIN_RSP_RECORD_SIZE + BIN_CRC_SIZE)
+#define BIN_REQ_MAX_ENCODED (BIN_REQ_MAX_SIZE + BIN_REQ_MAX_SIZE/254 + 2) // as FRAME_MAX_ENCODED
+
+// Requests are not read from RxQ while one is being processed, so every other
+// frame in flight must fit in RxQ (Q_SIZE in queue.h) or bytes are dropped.
+#define BIN_RXQ_SIZE (256)
+#define BIN_MAX_WINDOW (1 + BIN_RXQ_SIZE/BIN_REQ_MAX_ENCODED)
+
+// Sequence number of replies to frames whose own seq byte can't be trusted
+// (framing error, too short, bad CRC). Hosts number frames 0..BIN_SEQ_NONE-1
+// and resend everything outstanding when they see it.
+#define BIN_SEQ_NONE (0xFF)
+
+// Response status codes
+#define BIN_OK (0)
+#define BIN_ERR_CRC (1)
+#define BIN_ERR_LENGTH (2)
+#define BIN_ERR_FRAMING (3)
+
+extern void Binary_Mode(void);
+
+#endif // BIN_MODE_H
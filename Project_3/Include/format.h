@@ -0,0 +1,13 @@
+#ifndef FORMAT_H
+#define FORMAT_H
+
+#include <stdint.h>
+
+#define MAX_DECIMALS (6)
+#define OUTPUT_DECIMALS (MAX_DECIMALS) // same number of places as printf("%f")
+
+extern void Send_Uint(uint32_t n);
+extern void Send_Fixed(float value, unsigned int decimals);
+extern void Send_Field(const char * label, float value, unsigned int decimals);
+
+#endif // FORMAT_H
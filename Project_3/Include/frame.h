@@ -0,0 +1,30 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stdint.h>
+
+// COBS framing with 0x00 as the frame delimiter. No hardware dependencies, so
+// the host tool in Scripts builds this file unchanged.
+
+#define FRAME_DELIM (0x00)
+#define FRAME_MAX_DATA (254) // unencoded bytes per frame: keeps COBS overhead to one byte
+#define FRAME_MAX_ENCODED (FRAME_MAX_DATA + FRAME_MAX_DATA/254 + 2) // code bytes + delimiter
+
+typedef struct {
+	uint8_t * Data;     // decoded bytes of the frame in progress
+	unsigned int Size;  // capacity of Data
+	unsigned int Len;   // bytes decoded so far
+	uint8_t Code;       // last COBS code byte
+	uint8_t Left;       // data bytes left in current COBS block
+	uint8_t Error;      // frame overflowed or was malformed, discard at next delimiter
+} FRAME_DECODER_T;
+
+#define FRAME_IN_PROGRESS (0)
+#define FRAME_ERROR (-1)
+
+extern uint16_t CRC16(const uint8_t * data, unsigned int n);
+extern unsigned int COBS_Encode(const uint8_t * in, unsigned int n, uint8_t * out);
+extern void Frame_Decoder_Init(FRAME_DECODER_T * d, uint8_t * buffer, unsigned int size);
+extern int Frame_Decode_Byte(FRAME_DECODER_T * d, uint8_t c);
+
+#endif // FRAME_H
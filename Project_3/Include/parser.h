@@ -0,0 +1,17 @@
+#ifndef PARSER_H
+#define PARSER_H
+
+#define PARSE_OK (1)
+#define PARSE_UNKNOWN_ID (0)
+#define PARSE_FORMAT_ERROR (-1)
+#define PARSE_MISSING_FIELD (-2)
+
+#define PARSE_NUM_FIELDS (4)
+#define PARSE_ID_LEN (3)
+
+extern int Get_Line(char * buffer, unsigned int size);
+extern const char * Parse_Float(const char * p, float * value);
+extern int Parse_Input(const char * p, float * STW, float * HDG, float * TRK, float * SOG, 
+	char * bad_id);
+
+#endif // PARSER_H
@@ -8,11 +8,19 @@
 #define ON (1);
 #define OFF (0);
 
+typedef struct {
+  unsigned int Peak; // highest Size seen
+  unsigned int Num_Enqueued;
+  unsigned int Num_Dequeued;
+  unsigned int Num_Enqueue_Fails; // data dropped because queue was full
+} Q_STATS_T;
+
 typedef struct {
   unsigned char Data[Q_SIZE];
   unsigned int Head; // points to oldest data element 
   unsigned int Tail; // points to next free space
   unsigned int Size; // quantity of elements in queue
+  Q_STATS_T Stats; // cleared by Q_Init and Q_Clear_Stats
 } Q_T;
 
 
@@ -22,6 +30,7 @@ extern int Q_Size(Q_T * q);
 extern int Q_Enqueue(Q_T * q, uint8_t d);
 extern uint8_t Q_Dequeue(Q_T * q);
 extern void Q_Init(Q_T * q);
+extern void Q_Clear_Stats(Q_T * q);
 void clear_buffer(Q_T * q);
 
 #endif // QUEUE_H
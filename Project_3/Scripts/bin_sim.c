@@ -0,0 +1,173 @@
+/*----------------------------------------------------------------------------
+  Pseudo-terminal loopback for the binary Phase 3 protocol. Runs the board's
+  own Binary_Mode (bin_mode.c, frame.c, queue.c, Drift_Calculation.c) on the
+  host behind a pty, so bin_stream can be tested without a board.
+
+  A reader thread plays the UART RX ISR: it paces bytes at the baud rate
+  into a Q_SIZE RxQ and drops them when it is full, as the board does. Each
+  record can be made to take as long as it does on the board, and bytes can
+  be corrupted on the way in to exercise the error replies.
+
+  Build (Linux):
+    gcc -O2 -pthread -Isim -I../Include -o bin_sim bin_sim.c ../Source/bin_mode.c
+      ../Source/frame.c ../Source/queue.c ../Source/Drift_Calculation.c
+      ../Source/trig_approx.c -lm
+  Run:
+    ./bin_sim [-b baud] [-d us per record] [-c corrupt one byte in N]
+  then point bin_stream at the pty name it prints. Statistics are printed
+  on stderr each time the line goes idle.
+ *----------------------------------------------------------------------------*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <poll.h>
+#include <pthread.h>
+#include <time.h>
+
+#include "UART.h"
+#include "bin_mode.h"
+
+#define IDLE_REPORT_MS (1000)
+
+Q_T TxQ, RxQ;
+
+static int master;
+static long baud = 115200;
+static long us_per_record = 0;
+static unsigned long corrupt_every = 0;
+static pthread_mutex_t rxq_lock = PTHREAD_MUTEX_INITIALIZER; // stands in for __disable_irq
+
+static volatile unsigned long num_toggles, num_corrupted;
+
+// UART.c functions used by bin_mode.c
+void Send_Char(uint8_t c) {
+	while (write(master, &c, 1) < 0) {
+		if (errno != EINTR && errno != EAGAIN) {
+			perror("write");
+			exit(1);
+		}
+	}
+}
+
+uint8_t Get_Char(void) {
+	uint8_t c;
+
+	pthread_mutex_lock(&rxq_lock);
+	c = Q_Dequeue(&RxQ);
+	pthread_mutex_unlock(&rxq_lock);
+	return c;
+}
+
+// Toggled before and after each record's Compute_Current
+void Sim_Toggle_LED(void) {
+	struct timespec ts;
+
+	if ((++num_toggles & 1) || (us_per_record == 0))
+		return;
+	ts.tv_sec = us_per_record/1000000;
+	ts.tv_nsec = (us_per_record%1000000)*1000;
+	nanosleep(&ts, NULL);
+}
+
+static void Add_Ns(struct timespec * t, long ns) {
+	t->tv_nsec += ns;
+	while (t->tv_nsec >= 1000000000L) {
+		t->tv_nsec -= 1000000000L;
+		t->tv_sec++;
+	}
+}
+
+// The RX ISR: one byte per character time into RxQ, dropped when full
+static void * Rx_Thread(void * arg) {
+	uint8_t buf[256];
+	unsigned long num_in = 0, last_report = 0;
+	long byte_ns = baud ? 10*1000000000L/baud : 0; // start + 8 data + stop
+	struct timespec due;
+	struct pollfd pfd;
+	ssize_t n, i;
+
+	(void) arg;
+	pfd.fd = master;
+	pfd.events = POLLIN;
+	while (1) {
+		if (poll(&pfd, 1, IDLE_REPORT_MS) == 0) {
+			if (num_in != last_report) {
+				fprintf(stderr, "%lu bytes in, %u dropped (RxQ full, peak %u), %lu corrupted, %lu records\n",
+					num_in, RxQ.Stats.Num_Enqueue_Fails, RxQ.Stats.Peak, num_corrupted, num_toggles/2);
+				last_report = num_in;
+			}
+			continue;
+		}
+		n = read(master, buf, sizeof(buf));
+		if (n < 0) {
+			if (errno == EINTR || errno == EAGAIN || errno == EIO) { // EIO: no slave open
+				usleep(10000);
+				continue;
+			}
+			perror("read");
+			exit(1);
+		}
+		clock_gettime(CLOCK_MONOTONIC, &due);
+		for (i=0; i<n; i++, num_in++) {
+			if (corrupt_every && ((num_in % corrupt_every) == corrupt_every - 1)) {
+				buf[i] ^= 0x10;
+				num_corrupted++;
+			}
+			if (byte_ns) {
+				Add_Ns(&due, byte_ns);
+				clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &due, NULL);
+			}
+			pthread_mutex_lock(&rxq_lock);
+			Q_Enqueue(&RxQ, buf[i]);
+			pthread_mutex_unlock(&rxq_lock);
+		}
+	}
+	return NULL;
+}
+
+int main(int argc, char * argv[]) {
+	struct termios tio;
+	pthread_t rx;
+	int opt, slave;
+
+	while ((opt = getopt(argc, argv, "b:d:c:")) != -1) {
+		switch (opt) {
+			case 'b': baud = strtol(optarg, NULL, 10); break;
+			case 'd': us_per_record = strtol(optarg, NULL, 10); break;
+			case 'c': corrupt_every = strtoul(optarg, NULL, 10); break;
+			default:
+				fprintf(stderr, "usage: %s [-b baud] [-d us per record] [-c corrupt one byte in N]\n", argv[0]);
+				return 1;
+		}
+	}
+
+	master = posix_openpt(O_RDWR | O_NOCTTY);
+	if ((master < 0) || grantpt(master) || unlockpt(master)) {
+		perror("posix_openpt");
+		return 1;
+	}
+	// Hold the slave open so the master doesn't see hangups between host runs
+	slave = open(ptsname(master), O_RDWR | O_NOCTTY);
+	if ((slave < 0) || tcgetattr(slave, &tio)) {
+		perror(ptsname(master));
+		return 1;
+	}
+	cfmakeraw(&tio);
+	tcsetattr(slave, TCSANOW, &tio);
+
+	Q_Init(&TxQ);
+	Q_Init(&RxQ);
+	if (pthread_create(&rx, NULL, Rx_Thread, NULL)) {
+		perror("pthread_create");
+		return 1;
+	}
+	printf("%s\n", ptsname(master));
+	fflush(stdout);
+	Binary_Mode(); // never returns
+	return 0;
+}
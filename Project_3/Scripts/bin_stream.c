@@ -0,0 +1,454 @@
+/*----------------------------------------------------------------------------
+  Host tool for the binary Phase 3 protocol (see Include/bin_mode.h).
+  Streams every "STW:..,HDG:..,SOG:..,TRK:.." line of a file to the board,
+  prints "cspd,cang" per record on stdout and the throughput on stderr.
+
+  Build (Linux):
+    gcc -O2 -I../Include -o bin_stream bin_stream.c ../Source/frame.c ../Source/parser.c -lm
+  Run:
+    ./bin_stream /dev/ttyACM0 tests.txt [baud] [frames in flight]
+  Any tty works, including the pseudo-terminal bin_sim prints.
+  Parser benchmark (Parse_Input against the sscanf code it replaced):
+    ./bin_stream --bench tests.txt [repeats]
+ *----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <math.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <sys/select.h>
+#include <time.h>
+
+#include "frame.h"
+#include "bin_mode.h"
+#include "parser.h"
+
+#define REPLY_TIMEOUT_S (2)
+#define BENCH_REPEATS (1000)
+#define RESEND_QUIET_MS (100) // after an error reply, resend once the line goes quiet this long
+#define MAX_RETRIES (5) // resend rounds in a row without a good reply before giving up
+#define DEFAULT_WINDOW (2) // RxQ holds about one full request, so keep this small
+
+typedef char window_check[(DEFAULT_WINDOW <= BIN_MAX_WINDOW) ? 1 : -1];
+
+typedef struct {
+	float In[4]; // STW, HDG, SOG, TRK
+} RECORD_T;
+
+static speed_t Baud_To_Speed(long baud) {
+	switch (baud) {
+		case 9600: return B9600;
+		case 19200: return B19200;
+		case 38400: return B38400;
+		case 57600: return B57600;
+		case 115200: return B115200;
+		case 230400: return B230400;
+		case 460800: return B460800;
+		case 500000: return B500000;
+		case 921600: return B921600;
+		case 1000000: return B1000000;
+		case 1500000: return B1500000;
+		case 2000000: return B2000000;
+		default: return 0;
+	}
+}
+
+static int Open_Port(const char * name, long baud) {
+	struct termios tio;
+	speed_t speed = Baud_To_Speed(baud);
+	int fd;
+	
+	if (!speed) {
+		fprintf(stderr, "Unsupported baud rate %ld\n", baud);
+		return -1;
+	}
+	fd = open(name, O_RDWR | O_NOCTTY);
+	if (fd < 0) {
+		perror(name);
+		return -1;
+	}
+	if (tcgetattr(fd, &tio) == 0) { // not a serial line (e.g. a pipe) is fine too
+		cfmakeraw(&tio);
+		cfsetispeed(&tio, speed);
+		cfsetospeed(&tio, speed);
+		tio.c_cflag |= CLOCAL | CREAD;
+		tcsetattr(fd, TCSANOW, &tio);
+		tcflush(fd, TCIOFLUSH);
+	}
+	return fd;
+}
+
+static RECORD_T * Load_Records(const char * name, unsigned int * num) {
+	char line[256], id[PARSE_ID_LEN+1];
+	RECORD_T * recs = NULL;
+	unsigned int n = 0, cap = 0, line_num = 0;
+	FILE * f = fopen(name, "r");
+	
+	if (!f) {
+		perror(name);
+		return NULL;
+	}
+	while (fgets(line, sizeof(line), f)) {
+		line_num++;
+		if (line[strspn(line, " \t\r\n")] == '\0')
+			continue;
+		if (n == cap) {
+			cap = cap ? 2*cap : 1024;
+			recs = realloc(recs, cap*sizeof(RECORD_T));
+			if (!recs) {
+				fclose(f);
+				return NULL;
+			}
+		}
+		if (Parse_Input(line, &recs[n].In[0], &recs[n].In[1], &recs[n].In[3], &recs[n].In[2], id) != PARSE_OK) {
+			fprintf(stderr, "%s:%u: Input data format error.\n", name, line_num);
+			continue;
+		}
+		n++;
+	}
+	fclose(f);
+	*num = n;
+	return recs;
+}
+
+static int Write_All(int fd, const uint8_t * buf, unsigned int n) {
+	ssize_t w;
+	
+	while (n > 0) {
+		w = write(fd, buf, n);
+		if (w < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		buf += w;
+		n -= w;
+	}
+	return 0;
+}
+
+static int Send_Request(int fd, uint8_t seq, const RECORD_T * recs, unsigned int count) {
+	uint8_t raw[BIN_REQ_MAX_SIZE], enc[FRAME_MAX_ENCODED];
+	unsigned int len = BIN_HEADER_SIZE, i;
+	uint16_t crc;
+	
+	raw[0] = seq;
+	raw[1] = BIN_OK;
+	raw[2] = count;
+	for (i=0; i<count; i++) {
+		memcpy(&raw[len], recs[i].In, BIN_REQ_RECORD_SIZE); // both sides little-endian
+		len += BIN_REQ_RECORD_SIZE;
+	}
+	crc = CRC16(raw, len);
+	raw[len++] = crc >> 8;
+	raw[len++] = crc & 0xFF;
+	len = COBS_Encode(raw, len, enc);
+	return Write_All(fd, enc, len);
+}
+
+// Frames are kept until their reply arrives and can be sent again
+typedef struct {
+	unsigned int First_Rec;
+	unsigned int Count;
+	int Outstanding;
+} FRAME_INFO_T;
+
+// Resend every frame still waiting for a reply, oldest first. Replies carry no
+// seq after framing or CRC errors, so the host can't tell which frame was hit.
+static int Resend_Outstanding(int fd, FRAME_INFO_T * info, uint8_t next_seq, const RECORD_T * recs) {
+	unsigned int j;
+	uint8_t s;
+	int n = 0;
+	
+	for (j=BIN_SEQ_NONE; j>0; j--) {
+		s = (next_seq + BIN_SEQ_NONE - j) % BIN_SEQ_NONE;
+		if (info[s].Outstanding) {
+			if (Send_Request(fd, s, &recs[info[s].First_Rec], info[s].Count) < 0)
+				return -1;
+			n++;
+		}
+	}
+	return n;
+}
+
+static double Now(void) {
+	struct timespec ts;
+	
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec*1e-9;
+}
+
+// The original Get_Data loop, copied unchanged from before Parse_Input
+// replaced it, as the reference for --bench. It returns 1 or 0 and prints
+// its own error. sscanf's return is not checked and n is not reset, so a
+// missing or malformed field leaves it stepping by a stale n: only lines
+// Parse_Input accepts or rejects for an unknown identifier are given to it.
+static int Sscanf_Input(char * buffer, float * STW, float * HDG, float * TRK, float * SOG) {
+	char id[4];
+	char * p;
+	int i,n;
+	char debug = 0;
+	float value=0.0;
+
+	p = buffer;
+	while (!isalpha(*p)) // advance to start of buffer 
+			p++;
+
+	for (i=0; i<4; i++) {
+		sscanf(p, "%3s:%f,%n", id, &value, &n);
+		if (debug)
+			printf("\r\nGot it: %s and %f. Read %d chars.\r\n", id, value, n);
+		p += n;
+		if (debug)
+			printf("Remainder is %s\r\n", p);
+		if (!strcmp(id, "STW")) {
+			*STW = value;
+		} else if (!strcmp(id, "HDG")) {
+			*HDG = value;
+		} else if (!strcmp(id, "TRK")) {
+			*TRK = value;
+		} else if (!strcmp(id, "SOG")) {
+			*SOG = value;
+		} else {
+			printf("\r\nUnknown identifier: %s\r\n", id);
+			return 0;
+		}		
+	}
+	return 1;
+}
+
+// Check both parsers agree on every line of a file the original loop can
+// take, then time them over the lines Parse_Input accepts
+static int Bench_Parser(const char * name, unsigned int repeats) {
+	char line[256], id[PARSE_ID_LEN+1], ** lines = NULL;
+	unsigned int n = 0, num_ok = 0, skipped = 0, cap = 0, r, i, j, mismatches = 0;
+	float a[4], b[4];
+	volatile float sink = 0;
+	double t0, t_parse, t_sscanf;
+	int ra, rb;
+	FILE * f = fopen(name, "r");
+	
+	if (!f) {
+		perror(name);
+		return 1;
+	}
+	while (fgets(line, sizeof(line), f)) {
+		line[strcspn(line, "\r\n")] = '\0';
+		if (n == cap) {
+			cap = cap ? 2*cap : 1024;
+			lines = realloc(lines, cap*sizeof(char *));
+			if (!lines) {
+				fclose(f);
+				return 1;
+			}
+		}
+		lines[n++] = strdup(line);
+	}
+	fclose(f);
+	
+	// Accepted lines first, for the timing loops
+	for (i=0; i<n; i++) {
+		memset(a, 0, sizeof(a));
+		memset(b, 0, sizeof(b));
+		ra = Parse_Input(lines[i], &a[0], &a[1], &a[3], &a[2], id);
+		if ((ra != PARSE_OK) && (ra != PARSE_UNKNOWN_ID)) {
+			skipped++;
+			continue;
+		}
+		rb = Sscanf_Input(lines[i], &b[0], &b[1], &b[3], &b[2]);
+		if ((ra == PARSE_OK) != (rb == 1)) {
+			fprintf(stderr, "line %u: Parse_Input %d, sscanf loop %d: %s\n", i+1, ra, rb, lines[i]);
+			mismatches++;
+			continue;
+		}
+		for (j=0; (ra == PARSE_OK) && (j<4); j++) {
+			if (fabsf(a[j] - b[j]) > 1e-6f*fabsf(b[j])) { // within an ulp or so of strtof
+				fprintf(stderr, "line %u field %u: %.9g vs %.9g\n", i+1, j, a[j], b[j]);
+				mismatches++;
+				break;
+			}
+		}
+		if (ra == PARSE_OK) {
+			char * t = lines[num_ok];
+			lines[num_ok++] = lines[i];
+			lines[i] = t;
+		}
+	}
+	if (num_ok == 0) {
+		fprintf(stderr, "%s: no valid lines\n", name);
+		return 1;
+	}
+	
+	t0 = Now();
+	for (r=0; r<repeats; r++)
+		for (i=0; i<num_ok; i++) {
+			Parse_Input(lines[i], &a[0], &a[1], &a[3], &a[2], id);
+			sink += a[0];
+		}
+	t_parse = Now() - t0;
+	t0 = Now();
+	for (r=0; r<repeats; r++)
+		for (i=0; i<num_ok; i++) {
+			Sscanf_Input(lines[i], &b[0], &b[1], &b[3], &b[2]);
+			sink += b[0];
+		}
+	t_sscanf = Now() - t0;
+	
+	printf("%u lines x %u: Parse_Input %.1f ns/line, sscanf %.1f ns/line (%.1fx), %u mismatches, "
+		"%u lines not given to the sscanf loop\n",
+		num_ok, repeats, t_parse*1e9/((double) num_ok*repeats), t_sscanf*1e9/((double) num_ok*repeats),
+		t_parse > 0 ? t_sscanf/t_parse : 0.0, mismatches, skipped);
+	for (i=0; i<n; i++)
+		free(lines[i]);
+	free(lines);
+	return mismatches ? 2 : 0;
+}
+
+int main(int argc, char * argv[]) {
+	uint8_t rsp[BIN_RSP_MAX_SIZE], rx[512];
+	FRAME_DECODER_T decoder;
+	FRAME_INFO_T info[BIN_SEQ_NONE];
+	RECORD_T * recs;
+	float (* out)[2];
+	uint8_t * have;
+	unsigned int num_recs, next = 0, done = 0, frames = 0, errors = 0, rejected = 0, resends = 0;
+	unsigned int retries = 0;
+	unsigned int window = DEFAULT_WINDOW, in_flight = 0, count, i;
+	uint8_t seq = 0, s;
+	long baud = 115200;
+	double start, elapsed;
+	struct timeval tv;
+	fd_set rfds;
+	ssize_t n;
+	int fd, len, k, r, resend_pending = 0;
+	
+	if (argc < 3) {
+		fprintf(stderr, "usage: %s <tty> <input file> [baud] [frames in flight]\n"
+			"       %s --bench <input file> [repeats]\n", argv[0], argv[0]);
+		return 1;
+	}
+	if (!strcmp(argv[1], "--bench"))
+		return Bench_Parser(argv[2], (argc > 3) ? strtoul(argv[3], NULL, 10) : BENCH_REPEATS);
+	if (argc > 3)
+		baud = strtol(argv[3], NULL, 10);
+	if (argc > 4)
+		window = strtoul(argv[4], NULL, 10);
+	if (window < 1)
+		window = DEFAULT_WINDOW;
+	if (window > BIN_MAX_WINDOW) {
+		fprintf(stderr, "%u frames in flight would overflow the board's RxQ, using %u\n", 
+			window, BIN_MAX_WINDOW);
+		window = BIN_MAX_WINDOW;
+	}
+	
+	recs = Load_Records(argv[2], &num_recs);
+	if (!recs)
+		return 1;
+	out = malloc(num_recs*sizeof(*out) + 1);
+	have = calloc(num_recs + 1, 1);
+	if (!out || !have)
+		return 1;
+	fd = Open_Port(argv[1], baud);
+	if (fd < 0)
+		return 1;
+	memset(info, 0, sizeof(info));
+	Frame_Decoder_Init(&decoder, rsp, sizeof(rsp));
+	
+	start = Now();
+	while (done < num_recs) {
+		// keep up to window requests outstanding
+		while ((in_flight < window) && (next < num_recs)) {
+			count = num_recs - next;
+			if (count > BIN_MAX_RECORDS)
+				count = BIN_MAX_RECORDS;
+			info[seq].First_Rec = next;
+			info[seq].Count = count;
+			info[seq].Outstanding = 1;
+			if (Send_Request(fd, seq, &recs[next], count) < 0) {
+				perror("write");
+				return 1;
+			}
+			next += count;
+			seq = (seq + 1) % BIN_SEQ_NONE;
+			in_flight++;
+		}
+		
+		FD_ZERO(&rfds);
+		FD_SET(fd, &rfds);
+		tv.tv_sec = resend_pending ? 0 : REPLY_TIMEOUT_S;
+		tv.tv_usec = resend_pending ? RESEND_QUIET_MS*1000 : 0;
+		if (select(fd+1, &rfds, NULL, NULL, &tv) <= 0) {
+			resend_pending = 0;
+			if (++retries > MAX_RETRIES) {
+				fprintf(stderr, "Giving up with %u frames unanswered\n", in_flight);
+				break;
+			}
+			r = Resend_Outstanding(fd, info, seq, recs);
+			if (r < 0) {
+				perror("write");
+				return 1;
+			}
+			resends += r;
+			continue;
+		}
+		n = read(fd, rx, sizeof(rx));
+		if (n <= 0) {
+			perror("read");
+			break;
+		}
+		for (k=0; k<n; k++) {
+			len = Frame_Decode_Byte(&decoder, rx[k]);
+			if (len == FRAME_IN_PROGRESS)
+				continue;
+			if ((len < BIN_HEADER_SIZE + BIN_CRC_SIZE) ||
+				(((rsp[len-2] << 8) | rsp[len-1]) != CRC16(rsp, len - BIN_CRC_SIZE))) {
+				errors++; // can't tell which frame this answered
+				resend_pending = 1;
+				continue;
+			}
+			s = rsp[0];
+			if (s == BIN_SEQ_NONE) {
+				fprintf(stderr, "Board reported error %u, resending outstanding frames\n", rsp[1]);
+				errors++;
+				resend_pending = 1;
+				continue;
+			}
+			if (!info[s].Outstanding) // reply to a frame that was sent twice
+				continue;
+			info[s].Outstanding = 0;
+			in_flight--;
+			frames++;
+			retries = 0;
+			if ((rsp[1] != BIN_OK) || (rsp[2] != info[s].Count) ||
+				(len != BIN_HEADER_SIZE + rsp[2]*BIN_RSP_RECORD_SIZE + BIN_CRC_SIZE)) {
+				fprintf(stderr, "Frame %u rejected with status %u\n", s, rsp[1]);
+				rejected++;
+			} else {
+				for (i=0; i<rsp[2]; i++) {
+					memcpy(out[info[s].First_Rec + i], &rsp[BIN_HEADER_SIZE + i*BIN_RSP_RECORD_SIZE], 
+						BIN_RSP_RECORD_SIZE);
+					have[info[s].First_Rec + i] = 1;
+				}
+			}
+			done += info[s].Count;
+		}
+	}
+	elapsed = Now() - start;
+	
+	// Replies may have come back out of order after a resend
+	for (i=0; i<num_recs; i++) {
+		if (have[i])
+			printf("%f,%f\n", out[i][0], out[i][1]);
+	}
+	fprintf(stderr, "%u records in %u frames, %u rejected, %u errors, %u resent, %.3f s: %.1f records/s\n",
+		done, frames, rejected, errors, resends, elapsed, elapsed > 0 ? done/elapsed : 0.0);
+	close(fd);
+	free(recs);
+	free(out);
+	free(have);
+	return ((rejected > 0) || (done < num_recs)) ? 2 : 0;
+}
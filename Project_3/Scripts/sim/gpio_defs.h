@@ -0,0 +1,16 @@
+/*----------------------------------------------------------------------------
+  Host stand-in for Include/GPIO_defs.h (bin_mode.c includes it in lower case,
+  which only the Windows build resolves). The LED toggles around each
+  Compute_Current call become a hook so bin_sim can count records and model
+  the board's processing time.
+ *----------------------------------------------------------------------------*/
+#ifndef GPIO_DEFS_H
+#define GPIO_DEFS_H
+
+#define MASK(x) (1UL << (x))
+
+extern void Sim_Toggle_LED(void);
+
+#define TOGGLE_BLUE_LED {Sim_Toggle_LED();}
+
+#endif
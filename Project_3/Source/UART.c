@@ -3,6 +3,10 @@
 
 Q_T TxQ, RxQ;
 
+static uint32_t UART0_Actual_Baud;
+static int32_t UART0_Baud_Error_ppm;
+static UART_ERRORS_T UART0_Errors;
+
 /* BEGIN - UART0 Device Driver
 
 	Code created by Shannon Strutz
@@ -26,15 +30,78 @@ FILE __stdin;		//use with fget/sscanf, or scanf
 
 //Retarget the fputc method to use the UART0
 int fputc(int ch, FILE *f){
+#if USE_UART_INTERRUPTS
+	Send_Char(ch);
+#else
 	while(!(UART0->S1 & UART_S1_TDRE_MASK) && !(UART0->S1 & UART_S1_TC_MASK));
 	UART0->D = ch;
+#endif
 	return ch;
 }
 
 //Retarget the fgetc method to use the UART0
 int fgetc(FILE *f){
+#if USE_UART_INTERRUPTS
+	while (Q_Empty(&RxQ))
+		;
+	return Get_Char();
+#else
 	while(!(UART0->S1 & UART_S1_RDRF_MASK));
 	return UART0->D;
+#endif
+}
+
+// UART0 source clock when SOPT2 selects MCGFLLCLK or MCGPLLCLK/2. Assumes MCGOUTCLK is 
+// the FLL (FEI/FEE) or PLL (PEE) output, as in the CLOCK_SETUP options in system_MKL25Z4.h.
+uint32_t Get_UART0_Clock(void) {
+	uint32_t mcgout = SystemCoreClock * (((SIM->CLKDIV1 & SIM_CLKDIV1_OUTDIV1_MASK) >> SIM_CLKDIV1_OUTDIV1_SHIFT) + 1);
+	
+	if (SIM->SOPT2 & SIM_SOPT2_PLLFLLSEL_MASK)
+		return mcgout/2;
+	return mcgout;
+}
+
+uint32_t Get_UART0_Baud(void) {
+	return UART0_Actual_Baud;
+}
+
+int32_t Get_UART0_Baud_Error_ppm(void) {
+	return UART0_Baud_Error_ppm;
+}
+
+// Search oversampling ratios for the SBR giving the smallest baud error.
+// Higher OSR wins ties since it samples each bit more times.
+static void Set_UART0_Baud(uint32_t baud_rate) {
+	uint32_t clock = Get_UART0_Clock();
+	uint32_t osr, sbr, actual, err;
+	uint32_t best_osr = UART_OVERSAMPLE, best_sbr = 1, best_actual = 0, best_err = 0xFFFFFFFF;
+	
+	for (osr = UART_MAX_OSR; osr >= UART_MIN_OSR; osr--) {
+		sbr = (clock + (baud_rate*osr)/2)/(baud_rate*osr);
+		if (sbr < 1)
+			sbr = 1;
+		else if (sbr > UART_MAX_SBR)
+			sbr = UART_MAX_SBR;
+		actual = clock/(osr*sbr);
+		err = (actual > baud_rate) ? actual - baud_rate : baud_rate - actual;
+		if (err < best_err) {
+			best_err = err;
+			best_osr = osr;
+			best_sbr = sbr;
+			best_actual = actual;
+		}
+	}
+
+	UART0->BDH = UART0_BDH_SBR(best_sbr >> 8);
+	UART0->BDL = UART0_BDL_SBR(best_sbr & 0xFF);
+	UART0->C4  = UART0_C4_OSR(best_osr - 1);
+	if (best_osr < 8) // OSR 4 to 7 require sampling on both edges
+		UART0->C5 |= UART0_C5_BOTHEDGE_MASK;
+	else
+		UART0->C5 &= ~UART0_C5_BOTHEDGE_MASK;
+
+	UART0_Actual_Baud = best_actual;
+	UART0_Baud_Error_ppm = (int32_t) (((int64_t) best_actual - baud_rate)*1000000/baud_rate);
 }
 
 void Init_UART0(uint32_t baud_rate) {
@@ -43,10 +110,9 @@ void Init_UART0(uint32_t baud_rate) {
 	SIM->SOPT2 |= 0x04000000; /* use FLL output for UART Baud rate generator */
 	UART0->C2 = 0; /* turn off UART0 while changing configurations */
 
-	UART0->BDH = 0x00;
-	UART0->BDL = 0x1A; /* 115200 Baud */
-	UART0->C4  = 0x0F; /* Over Sampling Ratio 16 */
+	Set_UART0_Baud(baud_rate);
 	UART0->C1  = 0x00; /* 8-bit data */
+	UART0->C3  = UART0_C3_ORIE_MASK | UART0_C3_NEIE_MASK | UART0_C3_FEIE_MASK; /* interrupt on receive errors */
 	UART0->C2  = 0x24; /* enable receive and receive interrupt*/
 	UART0->C2 |= 0x08; /* enable transmit */	
 	//	NVIC->ISER[0] |= 0x00001000; /* enable INT12 (bit 12 of ISER[0]) */
@@ -56,6 +122,13 @@ void Init_UART0(uint32_t baud_rate) {
   
 	Q_Init(&TxQ);
 	Q_Init(&RxQ);
+	Clear_UART_Stats();
+
+#if USE_UART_INTERRUPTS
+	NVIC_SetPriority(UART0_IRQn, 128); // 0, 64, 128 or 192
+	NVIC_ClearPendingIRQ(UART0_IRQn); 
+	NVIC_EnableIRQ(UART0_IRQn);
+#endif
 
 }
 
@@ -86,8 +159,22 @@ void UART0_IRQHandler(void){
 		// NMEA_Receive();
 	}
 #else
-	if (UART0->S1 & UART0_S1_RDRF_MASK) {
-		// received a character
+	uint8_t status = UART0->S1;
+	
+	if (status & UART_RX_ERROR_MASK) {
+		// count and clear receive errors (write 1 to clear)
+		if (status & UART0_S1_OR_MASK)
+			UART0_Errors.Overrun++;
+		if (status & UART0_S1_NF_MASK)
+			UART0_Errors.Noise++;
+		if (status & UART0_S1_FE_MASK)
+			UART0_Errors.Framing++;
+		if (status & UART0_S1_PF_MASK)
+			UART0_Errors.Parity++;
+		UART0->S1 = status & UART_RX_ERROR_MASK;
+	}
+	if (status & UART0_S1_RDRF_MASK) {
+		// received a character; a full RxQ is counted in RxQ.Num_Enqueue_Fails
 		Q_Enqueue(&RxQ, UART0->D);
 	}
 	if ( (UART0->C2 & UART0_C2_TIE_MASK) && // transmitter interrupt enabled
@@ -181,19 +268,54 @@ int Buffer_State1(void){
 	}
 #endif
 
-	void Send_String(uint8_t * str) {
+void Send_String(uint8_t * str) {
 	// enqueue string
 	while (*str != '\0') { // copy characters up to null terminator
-		while (Q_Full(&TxQ))
-			; // wait for space to open up
-		Q_Enqueue(&TxQ, *str);
+		Send_Char(*str);
 		str++;
 	}
-	// start transmitter if it isn't already running
-	if (!(UART0->C2 & UART_C2_TIE_MASK)) {
-		UART0->C2 |= UART_C2_TIE_MASK;
-		UART0->D = Q_Dequeue(&TxQ); 
-	}
+}
+
+// Snapshot of receive error counters and both queues' statistics
+void Get_UART_Stats(UART_ERRORS_T * errors, Q_STATS_T * rx, Q_STATS_T * tx) {
+	uint32_t primask;
+	
+	primask = __get_PRIMASK();
+	__disable_irq();
+	if (errors)
+		*errors = UART0_Errors;
+	if (rx)
+		*rx = RxQ.Stats;
+	if (tx)
+		*tx = TxQ.Stats;
+	__set_PRIMASK(primask);
+}
+
+void Clear_UART_Stats(void) {
+	uint32_t primask;
+	
+	primask = __get_PRIMASK();
+	__disable_irq();
+	UART0_Errors.Overrun = 0;
+	UART0_Errors.Noise = 0;
+	UART0_Errors.Framing = 0;
+	UART0_Errors.Parity = 0;
+	Q_Clear_Stats(&RxQ);
+	Q_Clear_Stats(&TxQ);
+	__set_PRIMASK(primask);
+}
+
+void Print_UART_Stats(void) {
+	UART_ERRORS_T e;
+	Q_STATS_T rx, tx;
+	
+	Get_UART_Stats(&e, &rx, &tx);
+	printf("RxQ: %u in, %u out, peak %u/%d, %u dropped\r\n", 
+		rx.Num_Enqueued, rx.Num_Dequeued, rx.Peak, Q_SIZE, rx.Num_Enqueue_Fails);
+	printf("TxQ: %u in, %u out, peak %u/%d, %u dropped\r\n", 
+		tx.Num_Enqueued, tx.Num_Dequeued, tx.Peak, Q_SIZE, tx.Num_Enqueue_Fails);
+	printf("UART0 errors: %u overrun, %u noise, %u framing, %u parity\r\n",
+		e.Overrun, e.Noise, e.Framing, e.Parity);
 }
 
 uint32_t Get_Num_Rx_Chars_Available(void) {
@@ -201,6 +323,26 @@ uint32_t Get_Num_Rx_Chars_Available(void) {
 }
 
 uint8_t	Get_Char(void) {
-	return Q_Dequeue(&RxQ);
+	uint32_t primask;
+	uint8_t c;
+	
+	primask = __get_PRIMASK(); // Q_Dequeue races with Q_Enqueue in the ISR
+	__disable_irq();
+	c = Q_Dequeue(&RxQ);
+	__set_PRIMASK(primask);
+	return c;
+}
+
+void Send_Char(uint8_t c) {
+	uint32_t primask;
+	
+	while (Q_Full(&TxQ))
+		; // wait for space to open up
+	primask = __get_PRIMASK(); // Q_Enqueue races with Q_Dequeue in the ISR
+	__disable_irq();
+	Q_Enqueue(&TxQ, c);
+	__set_PRIMASK(primask);
+	// start transmitter if it isn't already running; TDRE interrupt drains TxQ
+	UART0->C2 |= UART0_C2_TIE_MASK;
 }
 // *******************************ARM University Program Copyright  ARM Ltd 2013*************************************   
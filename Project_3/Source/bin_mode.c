@@ -0,0 +1,95 @@
+#include <MKL25Z4.H>
+#include <string.h>
+
+#include "gpio_defs.h"
+#include "UART.h"
+#include "frame.h"
+#include "bin_mode.h"
+#include "Drift_Calculation.h"
+
+#if USE_BINARY_PROTOCOL && !USE_UART_INTERRUPTS
+#error Binary protocol reads frames from RxQ and needs USE_UART_INTERRUPTS
+#endif
+
+// BIN_MAX_WINDOW, which hosts rely on, assumes this queue size
+typedef char bin_rxq_size_check[(BIN_RXQ_SIZE == Q_SIZE) ? 1 : -1];
+// Encoded frames are sized for one COBS block (Tx_Frame, bin_stream enc[])
+typedef char bin_req_size_check[(BIN_REQ_MAX_SIZE <= FRAME_MAX_DATA) ? 1 : -1];
+
+// Binary request/response mode for Phase 3. Many records per frame, no ASCII
+// parsing or formatting. Frames are decoded byte by byte as they leave RxQ, so
+// the host may pipeline the next request while this one is being processed.
+
+static uint8_t Req_Frame[BIN_REQ_MAX_SIZE];
+static uint8_t Rsp_Frame[BIN_RSP_MAX_SIZE];
+static uint8_t Tx_Frame[FRAME_MAX_ENCODED];
+
+static void Send_Response(uint8_t seq, uint8_t status, uint8_t count) {
+	unsigned int len, i;
+	uint16_t crc;
+	
+	Rsp_Frame[0] = seq;
+	Rsp_Frame[1] = status;
+	Rsp_Frame[2] = count;
+	len = BIN_HEADER_SIZE + count*BIN_RSP_RECORD_SIZE;
+	crc = CRC16(Rsp_Frame, len);
+	Rsp_Frame[len++] = crc >> 8;
+	Rsp_Frame[len++] = crc & 0xFF;
+	
+	len = COBS_Encode(Rsp_Frame, len, Tx_Frame);
+	for (i=0; i<len; i++)
+		Send_Char(Tx_Frame[i]);
+}
+
+static void Process_Request(unsigned int len) {
+	uint8_t * rec, * out;
+	uint8_t count;
+	uint16_t crc;
+	float in[4], result[2];
+	unsigned int i;
+	
+	if (len < BIN_HEADER_SIZE + BIN_CRC_SIZE) {
+		Send_Response(BIN_SEQ_NONE, BIN_ERR_LENGTH, 0);
+		return;
+	}
+	crc = (Req_Frame[len-2] << 8) | Req_Frame[len-1];
+	if (crc != CRC16(Req_Frame, len - BIN_CRC_SIZE)) {
+		Send_Response(BIN_SEQ_NONE, BIN_ERR_CRC, 0); // seq byte may be the bad one
+		return;
+	}
+	count = Req_Frame[2];
+	if ((count > BIN_MAX_RECORDS) || 
+		(len != (unsigned int) (BIN_HEADER_SIZE + count*BIN_REQ_RECORD_SIZE + BIN_CRC_SIZE))) {
+		Send_Response(Req_Frame[0], BIN_ERR_LENGTH, 0);
+		return;
+	}
+	
+	rec = &Req_Frame[BIN_HEADER_SIZE];
+	out = &Rsp_Frame[BIN_HEADER_SIZE];
+	for (i=0; i<count; i++) {
+		memcpy(in, rec, BIN_REQ_RECORD_SIZE); // STW, HDG, SOG, TRK
+		TOGGLE_BLUE_LED // Do not delete - used for grading
+		Compute_Current(in[0], in[1], in[2], in[3], &result[0], &result[1]);
+		TOGGLE_BLUE_LED	// Do not delete - used for grading
+		memcpy(out, result, BIN_RSP_RECORD_SIZE);
+		rec += BIN_REQ_RECORD_SIZE;
+		out += BIN_RSP_RECORD_SIZE;
+	}
+	Send_Response(Req_Frame[0], BIN_OK, count);
+}
+
+void Binary_Mode(void) {
+	FRAME_DECODER_T decoder;
+	int len;
+	
+	Frame_Decoder_Init(&decoder, Req_Frame, sizeof(Req_Frame));
+	while (1) {
+		while (Q_Empty(&RxQ))
+			;
+		len = Frame_Decode_Byte(&decoder, Get_Char());
+		if (len > 0)
+			Process_Request(len);
+		else if (len == FRAME_ERROR)
+			Send_Response(BIN_SEQ_NONE, BIN_ERR_FRAMING, 0);
+	}
+}
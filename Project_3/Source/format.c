@@ -0,0 +1,71 @@
+#include <stdint.h>
+
+#include "UART.h"
+#include "format.h"
+
+// Fixed-format replacement for printf("%f") on results. Digits are produced by
+// subtracting powers of ten (no divide on the M0+) and are enqueued straight
+// into TxQ, so neither _printf_fp_dec_real nor the btod/_ll_udiv10 helpers are needed.
+
+static const uint32_t Pow10[] = {1000000000UL, 100000000UL, 10000000UL, 1000000UL,
+	100000UL, 10000UL, 1000UL, 100UL, 10UL, 1UL};
+
+#define NUM_POW10 (sizeof(Pow10)/sizeof(Pow10[0]))
+#define UINT32_LIMIT (4294967296.0f) // 2^32, first value whose integer part won't fit
+
+static const float Scale[MAX_DECIMALS+1] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f};
+
+// Send exactly num_digits digits of n (leading zeros included).
+static void Send_Digits(uint32_t n, unsigned int num_digits) {
+	unsigned int i;
+	uint8_t d;
+	
+	for (i = NUM_POW10 - num_digits; i < NUM_POW10; i++) {
+		for (d = '0'; n >= Pow10[i]; d++)
+			n -= Pow10[i];
+		Send_Char(d);
+	}
+}
+
+void Send_Uint(uint32_t n) {
+	unsigned int num_digits = 1;
+	
+	while ((num_digits < NUM_POW10) && (n >= Pow10[NUM_POW10 - 1 - num_digits]))
+		num_digits++;
+	Send_Digits(n, num_digits);
+}
+
+void Send_Fixed(float value, unsigned int decimals) {
+	uint32_t int_part, frac_part;
+	
+	if (decimals > MAX_DECIMALS)
+		decimals = MAX_DECIMALS;
+	if (value != value) { // NaN
+		Send_String((uint8_t *) "nan");
+		return;
+	}
+	if (value < 0) {
+		Send_Char('-');
+		value = -value;
+	}
+	if (value >= UINT32_LIMIT) { // includes inf; the conversion below would be undefined
+		Send_String((uint8_t *) "ovf");
+		return;
+	}
+	int_part = (uint32_t) value;
+	frac_part = (uint32_t) ((value - int_part)*Scale[decimals] + 0.5f); // round to nearest
+	if (frac_part >= Pow10[NUM_POW10 - 1 - decimals]) { // rounding carried into integer part
+		frac_part = 0;
+		int_part++;
+	}
+	Send_Uint(int_part);
+	if (decimals > 0) {
+		Send_Char('.');
+		Send_Digits(frac_part, decimals);
+	}
+}
+
+void Send_Field(const char * label, float value, unsigned int decimals) {
+	Send_String((uint8_t *) label);
+	Send_Fixed(value, decimals);
+}
@@ -0,0 +1,92 @@
+#include <stdint.h>
+
+#include "frame.h"
+
+// CRC-16/CCITT (poly 0x1021, init 0xFFFF), one nibble per table lookup to keep
+// the table at 32 bytes of flash.
+static const uint16_t CRC_Nibble_Table[16] = {
+	0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7,
+	0x8108, 0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef
+};
+
+uint16_t CRC16(const uint8_t * data, unsigned int n) {
+	uint16_t crc = 0xFFFF;
+	
+	while (n--) {
+		crc = (crc << 4) ^ CRC_Nibble_Table[(crc >> 12) ^ (*data >> 4)];
+		crc = (crc << 4) ^ CRC_Nibble_Table[(crc >> 12) ^ (*data & 0x0F)];
+		data++;
+	}
+	return crc;
+}
+
+// Encode n bytes (n <= FRAME_MAX_DATA) into out, followed by the delimiter.
+// Returns the number of bytes written to out.
+unsigned int COBS_Encode(const uint8_t * in, unsigned int n, uint8_t * out) {
+	unsigned int code_idx = 0, o = 1;
+	uint8_t code = 1;
+	
+	while (n--) {
+		if (*in == FRAME_DELIM) {
+			out[code_idx] = code;
+			code_idx = o++;
+			code = 1;
+		} else {
+			out[o++] = *in;
+			code++;
+			if (code == 0xFF) {
+				out[code_idx] = code;
+				code_idx = o++;
+				code = 1;
+			}
+		}
+		in++;
+	}
+	out[code_idx] = code;
+	out[o++] = FRAME_DELIM;
+	return o;
+}
+
+void Frame_Decoder_Init(FRAME_DECODER_T * d, uint8_t * buffer, unsigned int size) {
+	d->Data = buffer;
+	d->Size = size;
+	d->Len = 0;
+	d->Code = 0;
+	d->Left = 0;
+	d->Error = 0;
+}
+
+// Feed one received byte. Returns the decoded length when a delimiter ends a
+// good frame, FRAME_ERROR when it ends a bad one, else FRAME_IN_PROGRESS.
+int Frame_Decode_Byte(FRAME_DECODER_T * d, uint8_t c) {
+	int result = FRAME_IN_PROGRESS;
+	
+	if (c == FRAME_DELIM) {
+		if (d->Error || (d->Left != 0))
+			result = FRAME_ERROR;
+		else if (d->Len > 0)
+			result = d->Len;
+		d->Len = 0;
+		d->Code = 0;
+		d->Left = 0;
+		d->Error = 0;
+	} else if (d->Error) {
+		; // wait for the next delimiter to resynchronize
+	} else if (d->Left == 0) { // c is a code byte
+		if ((d->Code != 0) && (d->Code != 0xFF)) { // previous block ended with a zero
+			if (d->Len < d->Size)
+				d->Data[d->Len++] = 0;
+			else
+				d->Error = 1;
+		}
+		d->Code = c;
+		d->Left = c - 1;
+	} else {
+		if (d->Len < d->Size)
+			d->Data[d->Len++] = c;
+		else
+			d->Error = 1;
+		d->Left--;
+	}
+	return result;
+}
@@ -3,8 +3,6 @@
 #include <MKL25Z4.H>
 #include <stdio.h>
 #include <math.h>
-#include <ctype.h>
-#include <string.h>
 
 #include "gpio_defs.h"
 #include "UART.h"
@@ -15,6 +13,9 @@
 #include "profile.h"
 #include "region.h"
 #include "Drift_Calculation.h"
+#include "parser.h"
+#include "format.h"
+#include "bin_mode.h"
 
 #define NUM_TESTS 100
 #define MAX_MAG_ERROR 0.1
@@ -43,42 +44,22 @@ TEST_CASE Tests[] = {
 };
 
 int Get_Data(float * STW, float * HDG, float * TRK, float * SOG) {
-	char id[4], buffer[100];
-	char * p;
-	int i,n;
-	char debug = 0;
-	float value=0.0;
+	char id[PARSE_ID_LEN+1], buffer[101];
 	
 	printf("\r\nEnter the input data with this format: \r\nSTW:1.2345,HDG:124.23,SOG:1.3525,TRK:155.33\r\n");
 	// Order doesn't matter
-	scanf("%100[^\r]", buffer);
+	Get_Line(buffer, sizeof(buffer));
 	printf("\r\nReceived: %s\r\n", buffer);
 
-	p = buffer;
-	while (!isalpha(*p)) // advance to start of buffer 
-			p++;
-
-	for (i=0; i<4; i++) {
-		sscanf(p, "%3s:%f,%n", id, &value, &n);
-		if (debug)
-			printf("\r\nGot it: %s and %f. Read %d chars.\r\n", id, value, n);
-		p += n;
-		if (debug)
-			printf("Remainder is %s\r\n", p);
-		if (!strcmp(id, "STW")) {
-			*STW = value;
-		} else if (!strcmp(id, "HDG")) {
-			*HDG = value;
-		} else if (!strcmp(id, "TRK")) {
-			*TRK = value;
-		} else if (!strcmp(id, "SOG")) {
-			*SOG = value;
-		} else {
+	switch (Parse_Input(buffer, STW, HDG, TRK, SOG, id)) {
+		case PARSE_OK:
+			return 1;
+		case PARSE_UNKNOWN_ID:
 			printf("\r\nUnknown identifier: %s\r\n", id);
 			return 0;
-		}		
+		default:										// format error or missing field: no message
+			return 0;
 	}
-	return 1;
 }
 
 /*----------------------------------------------------------------------------
@@ -97,7 +78,7 @@ int main (void) {
 //  Init_Profiling();
 	Init_RGB_LEDs();
 	__disable_irq();
-	Init_UART0(115200);
+	Init_UART0(UART0_BAUD_RATE);
 	__enable_irq();
 	printf("\r\n\nProject 3 Base Code\r\n");
 	printf("\r\nSiddharth Ganesh (sganesh6) \n\rAbhishek Ravi (aravi6)\n");
@@ -133,19 +114,29 @@ int main (void) {
 	printf("\r\n");
 	Sort_Profile_Regions();
 	Print_Sorted_Profile();
+	Print_UART_Stats();
 	Control_RGB_LEDs(0,1,0);
 
 	// Phase 3: Process test cases from serial port
-	// This code allows testing with input data from the serial port (115.200 kbaud, 8N1)
+	// This code allows testing with input data from the serial port (UART0_BAUD_RATE, 8N1)
+#if USE_BINARY_PROTOCOL
+	Binary_Mode(); // does not return
+#endif
 	while (1) {
 		if (Get_Data(&stw, &hdg, &trk, &sog)) {
-			printf("STW:%f, HDG:%f, TRK:%f, SOG:%f\r\n", stw, hdg, trk, sog);
+			Send_Field("STW:", stw, OUTPUT_DECIMALS);
+			Send_Field(", HDG:", hdg, OUTPUT_DECIMALS);
+			Send_Field(", TRK:", trk, OUTPUT_DECIMALS);
+			Send_Field(", SOG:", sog, OUTPUT_DECIMALS);
+			Send_String((uint8_t *) "\r\n");
 			cspd = 0;
 			cang = 0;
 			TOGGLE_BLUE_LED // Do not delete - used for grading
 			Compute_Current(stw, hdg, sog, trk, &cspd, &cang);
 			TOGGLE_BLUE_LED	// Do not delete - used for grading
-			printf("Current speed: %f, Current direction: %f\r\n", cspd, cang);
+			Send_Field("Current speed: ", cspd, OUTPUT_DECIMALS);
+			Send_Field(", Current direction: ", cang, OUTPUT_DECIMALS);
+			Send_String((uint8_t *) "\r\n");
 		} else {
 			printf("Input data format error.\r\n"); 
 		}
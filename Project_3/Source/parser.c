@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <stdint.h>
+
+#include "parser.h"
+
+// Single-pass replacement for scanf("%100[^\r]") and sscanf("%3s:%f,%n") in Get_Data.
+// Keys are matched character by character and numbers are converted with
+// integer arithmetic plus a single float scale, so none of the _scanf_real/btod
+// library code is linked in.
+
+#define MAX_MANTISSA (100000000UL) // stop accumulating digits beyond 9 significant figures
+#define MAX_EXPONENT (99) // well past float range, keeps the scaling loops short
+
+static const float Pow10[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f};
+
+#define IS_DIGIT(c) ((unsigned)((c) - '0') < 10)
+#define IS_SPACE(c) (((c) == ' ') || ((c) == '\t'))
+
+// Read characters up to (not including) the next CR or LF. Leading CR/LF left
+// over from the previous line are skipped. Returns number of characters stored.
+int Get_Line(char * buffer, unsigned int size) {
+	unsigned int n = 0;
+	int c;
+	
+	do {
+		c = fgetc(stdin);
+	} while ((c == '\r') || (c == '\n'));
+	
+	while ((c != '\r') && (c != '\n') && (c != EOF)) {
+		if (n < size-1)
+			buffer[n++] = c;
+		c = fgetc(stdin);
+	}
+	buffer[n] = '\0';
+	return n;
+}
+
+// Convert [sign]digits[.digits][e[sign]digits] starting at p. Returns pointer to
+// first character not consumed, or 0 if no digits were found (value is left
+// unchanged). An 'e' not followed by exponent digits is left unconsumed, as strtof does.
+const char * Parse_Float(const char * p, float * value) {
+	uint32_t mantissa = 0;
+	int exp10 = 0, negative = 0, digits = 0, e = 0, e_negative = 0;
+	const char * q;
+	float f;
+	
+	while (IS_SPACE(*p))
+		p++;
+	if (*p == '-') {
+		negative = 1;
+		p++;
+	} else if (*p == '+') {
+		p++;
+	}
+	for (; IS_DIGIT(*p); p++, digits++) {
+		if (mantissa < MAX_MANTISSA)
+			mantissa = mantissa*10 + (*p - '0');
+		else
+			exp10++; // integer digit beyond precision: just track its weight
+	}
+	if (*p == '.') {
+		for (p++; IS_DIGIT(*p); p++, digits++) {
+			if (mantissa < MAX_MANTISSA) {
+				mantissa = mantissa*10 + (*p - '0');
+				exp10--;
+			}
+		}
+	}
+	if (digits == 0)
+		return 0;
+	if ((*p | 0x20) == 'e') {
+		q = p + 1;
+		if (*q == '-') {
+			e_negative = 1;
+			q++;
+		} else if (*q == '+') {
+			q++;
+		}
+		if (IS_DIGIT(*q)) {
+			for (; IS_DIGIT(*q); q++) {
+				if (e < MAX_EXPONENT)
+					e = e*10 + (*q - '0');
+			}
+			exp10 += e_negative ? -e : e;
+			p = q;
+		}
+	}
+	
+	f = (float) mantissa;
+	for (; exp10 < -9; exp10 += 9)
+		f /= Pow10[9];
+	for (; exp10 > 9; exp10 -= 9)
+		f *= Pow10[9];
+	if (exp10 < 0)
+		f /= Pow10[-exp10];
+	else
+		f *= Pow10[exp10];
+	
+	*value = negative ? -f : f;
+	return p;
+}
+
+// Parse "STW:1.2345,HDG:124.23,SOG:1.3525,TRK:155.33" (any order) in one pass.
+// On PARSE_UNKNOWN_ID the offending key (up to 3 chars) is copied to bad_id.
+// A line that ends before all four fields returns PARSE_MISSING_FIELD.
+int Parse_Input(const char * p, float * STW, float * HDG, float * TRK, float * SOG, 
+	char * bad_id) {
+	float * dest;
+	float value;
+	int i, n;
+	
+	while ((*p != '\0') && !(((*p|0x20) >= 'a') && ((*p|0x20) <= 'z'))) // advance to start of buffer 
+		p++;
+	
+	for (i=0; i<PARSE_NUM_FIELDS; i++) {
+		while (IS_SPACE(*p))
+			p++;
+		if (*p == '\0')
+			return PARSE_MISSING_FIELD;
+		dest = 0;
+		switch (p[0]) {
+			case 'S':
+				if (p[1] == 'T' && p[2] == 'W')
+					dest = STW;
+				else if (p[1] == 'O' && p[2] == 'G')
+					dest = SOG;
+				break;
+			case 'H':
+				if (p[1] == 'D' && p[2] == 'G')
+					dest = HDG;
+				break;
+			case 'T':
+				if (p[1] == 'R' && p[2] == 'K')
+					dest = TRK;
+				break;
+			default:
+				break;
+		}
+		if (!dest) {
+			for (n=0; (n < PARSE_ID_LEN) && (p[n] != '\0') && !IS_SPACE(p[n]); n++)
+				bad_id[n] = p[n];
+			bad_id[n] = '\0';
+			return PARSE_UNKNOWN_ID;
+		}
+		if (p[PARSE_ID_LEN] != ':')
+			return PARSE_FORMAT_ERROR;
+		p = Parse_Float(p + PARSE_ID_LEN + 1, &value);
+		if (!p)
+			return PARSE_FORMAT_ERROR;
+		*dest = value;
+		if (*p == ',')
+			p++;
+	}
+	return PARSE_OK;
+}
@@ -7,6 +7,14 @@ void Q_Init(Q_T * q) {
   q->Head = OFF;
   q->Tail = OFF;
   q->Size = OFF;
+  Q_Clear_Stats(q);
+}
+
+void Q_Clear_Stats(Q_T * q) {
+  q->Stats.Peak = q->Size;
+  q->Stats.Num_Enqueued = 0;
+  q->Stats.Num_Dequeued = 0;
+  q->Stats.Num_Enqueue_Fails = 0;
 }
 
 int Q_Empty(Q_T * q) {
@@ -29,9 +37,14 @@ int Q_Enqueue(Q_T * q, uint8_t d) {
 		q->Tail++;
     q->Tail %= Q_SIZE;
     q->Size++;
+    q->Stats.Num_Enqueued++;
+    if (q->Size > q->Stats.Peak)
+      q->Stats.Peak = q->Size;
     return 1; // success
-  } else 
+  } else {
+    q->Stats.Num_Enqueue_Fails++;
     return 0; // failure
+  }
 }
 
 uint8_t Q_Dequeue(Q_T * q) {
@@ -42,6 +55,7 @@ uint8_t Q_Dequeue(Q_T * q) {
     q->Data[q->Head++] = 0; // empty unused entries for debugging
     q->Head %= Q_SIZE;
     q->Size--;
+    q->Stats.Num_Dequeued++;
   }
   return t;
 }
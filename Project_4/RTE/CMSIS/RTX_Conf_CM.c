@@ -35,6 +35,10 @@
 #include "cmsis_os.h"
  
 #include "GPIO_defs.h"
+#include "config.h"
+#include "tickless.h"
+#include "thread_stats.h"
+#include "pipeline.h"
 
 /*----------------------------------------------------------------------------
  *      RTX User configuration part BEGIN
@@ -70,14 +74,14 @@
 //   <i> Defines the number of threads with user-provided stack size.
 //   <i> Default: 0
 #ifndef OS_PRIVCNT
- #define OS_PRIVCNT     0
+ #define OS_PRIVCNT     3       // pipeline.c threads
 #endif
  
 //   <o>Total stack size [bytes] for threads with user-provided stack size <0-1048576:8><#/4>
 //   <i> Defines the combined stack size for threads with user-provided stack size.
 //   <i> Default: 0
 #ifndef OS_PRIVSTKSIZE
- #define OS_PRIVSTKSIZE 0       // this stack size value is in words
+ #define OS_PRIVSTKSIZE 208     // this stack size value is in words
 #endif
  
 //   <q>Stack overflow checking
@@ -91,7 +95,7 @@
 //   <i> Initialize thread stack with watermark pattern for analyzing stack usage (current/maximum) in System and Thread Viewer.
 //   <i> Enabling this option increases significantly the execution time of osThreadCreate.
 #ifndef OS_STKINIT
-#define OS_STKINIT      0
+#define OS_STKINIT      USE_THREAD_STATS	// thread_stats.c scans for the fill
 #endif
  
 //   <o>Processor mode for thread execution 
@@ -118,7 +122,7 @@
 //   <i> When the Cortex-M SysTick timer is used, the input clock 
 //   <i> is on most systems identical with the core clock.
 #ifndef OS_CLOCK
- #define OS_CLOCK       48000000
+ #define OS_CLOCK       4000000 // CLOCK_SETUP 2: 4 MHz fast IRC core clock
 #endif
  
 //   <o>RTX Timer tick interval value [us] <1-1000000>
@@ -139,7 +143,7 @@
 //
 // <i> Enables Round-Robin Thread switching.
 #ifndef OS_ROBIN
- #define OS_ROBIN       1
+ #define OS_ROBIN       0       // thread_stats.c: threads switch only when they block
 #endif
  
 //   <o>Round-Robin Timeout [ticks] <1-1000>
@@ -166,7 +170,7 @@
 //   <i> Defines priority for Timer Thread
 //   <i> Default: High
 #ifndef OS_TIMERPRIO
- #define OS_TIMERPRIO   5
+ #define OS_TIMERPRIO   2       // below the pipeline.c threads
 #endif
  
 //   <o>Timer Thread stack size [bytes] <64-4096:8><#/4>
@@ -213,6 +217,33 @@
  *      RTX User configuration part END
  *---------------------------------------------------------------------------*/
  
+#if (OS_PRIVCNT != PIPE_THREADS) || (OS_PRIVSTKSIZE != PIPE_STACK_WORDS)
+ #error "OS_PRIVCNT and OS_PRIVSTKSIZE must cover the pipeline.c thread stacks"
+#endif
+
+#if USE_THREAD_STATS && OS_ROBIN
+ #error "thread_stats.c needs OS_ROBIN 0: a thread may only lose the CPU by blocking"
+#endif
+
+// OS_TIMERPRIO counts from 1 for osPriorityLow
+typedef char os_priority_check[((SAMPLE_PRIORITY != PROCESS_PRIORITY) &&
+	(SAMPLE_PRIORITY != OUTPUT_PRIORITY) && (PROCESS_PRIORITY != OUTPUT_PRIORITY) &&
+	(OS_TIMERPRIO-3 != SAMPLE_PRIORITY) && (OS_TIMERPRIO-3 != PROCESS_PRIORITY) &&
+	(OS_TIMERPRIO-3 != OUTPUT_PRIORITY)) ? 1 : -1];
+
+#if USE_THREAD_STATS && (!OS_STKCHECK || (OS_STKSIZE != THREAD_STACK_WORDS) || (OS_TIMERSTKSZ != THREAD_STACK_WORDS))
+ #error "thread_stats.c needs OS_STKCHECK and OS_STKSIZE, OS_TIMERSTKSZ equal to THREAD_STACK_WORDS"
+#endif
+
+// THREAD_STACK_MAGIC and THREAD_STACK_PATTERN are what RTX 4 writes
+#if USE_THREAD_STATS && (!OS_STKINIT || ((osCMSIS_RTX >> 16) != 4))
+ #error "thread_stats.c needs OS_STKINIT and RTX 4 for its stack base and fill words"
+#endif
+
+#if USE_TICKLESS_IDLE && (OS_TICK != TICKLESS_TICK_US)
+ #error "OS_TICK must match TICKLESS_TICK_US, one LPTMR count"
+#endif
+
 #define OS_TRV          ((uint32_t)(((double)OS_CLOCK*(double)OS_TICK)/1E6)-1)
  
 
@@ -226,10 +257,21 @@ volatile int idle_counter=0;
 /// \brief The idle demon is running when no other thread is ready to run
 void os_idle_demon (void) {
  
+#if USE_THREAD_STATS
+	Thread_Stats_Register_Idle();
+#endif
   for (;;) {
     /* HERE: include optional user code to be executed when no thread runs.*/
+#if USE_THREAD_STATS
+		idle_counter++;						// idle passes: wakes with tickless idle
+#else
 		// idle_counter++;
+#endif
+#if USE_TICKLESS_IDLE
+		Tickless_Idle();
+#else
 		TOGGLE_BIT(DEBUG3_POS);
+#endif
   }
 }
  
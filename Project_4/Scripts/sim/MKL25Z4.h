@@ -0,0 +1,327 @@
+/*----------------------------------------------------------------------------
+  Host stand-in for the KL25Z device and CMSIS core headers, for the builds
+  in Scripts/. Peripherals are plain structs in RAM except I2C0, which is a
+  register-level model (sim.cpp) when the sources are compiled as C++: reads
+  and writes of its registers move bytes on a simulated bus. The LLWU pin
+  flags are write-1-to-clear in C++ builds too.
+
+  Only what the firmware sources use is declared. Bit positions follow the
+  KL25 reference manual.
+ *----------------------------------------------------------------------------*/
+#ifndef MKL25Z4_H_SIM
+#define MKL25Z4_H_SIM
+
+#include <stdint.h>
+// mma8451.h defines its own M_PI: take math.h's now and drop its definition,
+// so later includes of math.h are no-ops and there is no redefinition
+#include <math.h>
+#undef M_PI
+
+typedef struct {
+	volatile uint32_t SOPT1, SOPT2, SCGC4, SCGC5, SCGC6, CLKDIV1, SRVCOP;
+} SIM_Type;
+
+typedef struct {
+	volatile uint32_t PCR[32];
+	volatile uint32_t ISFR;
+} PORT_Type;
+
+typedef struct {
+	volatile uint32_t PDOR, PSOR, PCOR, PTOR, PDIR, PDDR;
+} GPIO_Type, FGPIO_Type;
+
+#ifdef __cplusplus
+// One I2C0 register: every access goes through the bus model
+class Sim_I2C_Reg {
+public:
+	explicit Sim_I2C_Reg(uint8_t offset) : offset_(offset) {}
+	operator uint8_t();
+	Sim_I2C_Reg & operator=(uint32_t value);
+	Sim_I2C_Reg & operator|=(uint32_t value);
+	Sim_I2C_Reg & operator&=(uint32_t value);
+private:
+	uint8_t offset_;
+};
+
+typedef struct {
+	Sim_I2C_Reg A1, F, C1, S, D, C2, FLT, RA, SMB, A2, SLTH, SLTL;
+} I2C_Type;
+#else
+typedef struct {
+	volatile uint8_t A1, F, C1, S, D, C2, FLT, RA, SMB, A2, SLTH, SLTL;
+} I2C_Type;
+#endif
+
+typedef struct {
+	volatile uint32_t CSR, PSR, CMR, CNR;
+} LPTMR_Type;
+
+typedef struct {
+	volatile uint8_t PMPROT, PMCTRL, STOPCTRL, PMSTAT;
+} SMC_Type;
+
+#ifdef __cplusplus
+// Write-1-to-clear flag register. Set() is the hardware raising flags.
+class Sim_W1C_Reg {
+public:
+	operator uint8_t() const { return value_; }
+	Sim_W1C_Reg & operator=(uint32_t value) { value_ &= ~value; return *this; }
+	void Set(uint8_t bits) { value_ |= bits; }
+	void Reset(void) { value_ = 0; }
+private:
+	uint8_t value_;
+};
+
+typedef struct {
+	volatile uint8_t PE1, PE2, PE3, PE4, ME;
+	Sim_W1C_Reg F1, F2;
+	volatile uint8_t F3, FILT1, FILT2;		// module flags clear in the module
+} LLWU_Type;
+#else
+typedef struct {
+	volatile uint8_t PE1, PE2, PE3, PE4, ME, F1, F2, F3, FILT1, FILT2;
+} LLWU_Type;
+#endif
+
+typedef struct {
+	volatile uint8_t LVDSC1, LVDSC2, REGSC;
+} PMC_Type;
+
+typedef struct {
+	volatile uint8_t SRS0, SRS1, RPFC, RPFW;
+} RCM_Type;
+
+typedef struct {
+	volatile uint32_t CnSC, CnV;
+} TPM_Channel_Type;
+
+typedef struct {
+	volatile uint32_t SC, CNT, MOD;
+	TPM_Channel_Type CONTROLS[6];
+	volatile uint32_t STATUS, CONF;
+} TPM_Type;
+
+typedef struct {
+	volatile uint8_t C1, C2, C3, C4, C5, C6, S;
+} MCG_Type;
+
+typedef struct {
+	volatile uint32_t TSR, TPR, TAR, TCR, CR, SR, LR, IER;
+} RTC_Type;
+
+typedef struct {
+	volatile uint32_t CPUID, ICSR, VTOR, AIRCR, SCR, CCR, SHP[2], SHCSR;
+} SCB_Type;
+
+typedef struct {
+	volatile uint32_t CTRL, LOAD, VAL, CALIB;
+} SysTick_Type;
+
+extern SIM_Type Sim_SIM;
+extern PORT_Type Sim_PORTA, Sim_PORTB, Sim_PORTC, Sim_PORTD, Sim_PORTE;
+extern GPIO_Type Sim_PTA, Sim_PTB, Sim_PTC, Sim_PTD, Sim_PTE;
+extern I2C_Type Sim_I2C0;
+extern LPTMR_Type Sim_LPTMR0;
+extern SMC_Type Sim_SMC;
+extern LLWU_Type Sim_LLWU;
+extern PMC_Type Sim_PMC;
+extern RCM_Type Sim_RCM;
+extern TPM_Type Sim_TPM0, Sim_TPM1, Sim_TPM2;
+extern MCG_Type Sim_MCG;
+extern RTC_Type Sim_RTC;
+extern SCB_Type Sim_SCB;
+extern SysTick_Type Sim_SysTick;
+
+#define SIM (&Sim_SIM)
+#define PORTA (&Sim_PORTA)
+#define PORTB (&Sim_PORTB)
+#define PORTC (&Sim_PORTC)
+#define PORTD (&Sim_PORTD)
+#define PORTE (&Sim_PORTE)
+#define PTA (&Sim_PTA)
+#define PTB (&Sim_PTB)
+#define PTC (&Sim_PTC)
+#define PTD (&Sim_PTD)
+#define PTE (&Sim_PTE)
+#define FPTA (&Sim_PTA)
+#define FPTB (&Sim_PTB)
+#define FPTC (&Sim_PTC)
+#define FPTD (&Sim_PTD)
+#define FPTE (&Sim_PTE)
+#define I2C0 (&Sim_I2C0)
+#define LPTMR0 (&Sim_LPTMR0)
+#define SMC (&Sim_SMC)
+#define LLWU (&Sim_LLWU)
+#define PMC (&Sim_PMC)
+#define RCM (&Sim_RCM)
+#define TPM0 (&Sim_TPM0)
+#define TPM1 (&Sim_TPM1)
+#define TPM2 (&Sim_TPM2)
+#define MCG (&Sim_MCG)
+#define RTC (&Sim_RTC)
+#define SCB (&Sim_SCB)
+#define SysTick (&Sim_SysTick)
+
+typedef enum {
+	SysTick_IRQn = -1, LLWU_IRQn = 7, I2C0_IRQn = 8, UART0_IRQn = 12, TPM0_IRQn = 17,
+	TPM1_IRQn = 18, TPM2_IRQn = 19, RTC_IRQn = 20, LPTimer_IRQn = 28, PORTA_IRQn = 30,
+	PORTD_IRQn = 31
+} IRQn_Type;
+
+extern uint32_t SystemCoreClock;
+
+void NVIC_SetPriority(IRQn_Type irq, uint32_t priority);
+void NVIC_EnableIRQ(IRQn_Type irq);
+void NVIC_DisableIRQ(IRQn_Type irq);
+void NVIC_ClearPendingIRQ(IRQn_Type irq);
+void __wfi(void);
+void __enable_irq(void);
+void __disable_irq(void);
+uint32_t __get_PRIMASK(void);
+void __set_PRIMASK(uint32_t primask);
+uintptr_t __get_PSP(void);
+void __nop(void);
+void __DSB(void);
+void __ISB(void);
+#define __WFI __wfi
+#define __NOP __nop
+
+#define SIM_MASK(n) (1U << (n))
+#define SIM_FIELD(x, shift, mask) (((uint32_t) (x) << (shift)) & (mask))
+
+#define SIM_SOPT1_OSC32KSEL(x) SIM_FIELD(x, 18, 0xC0000U)
+#define SIM_SOPT1_OSC32KSEL_MASK 0xC0000U
+#define SIM_SOPT2_TPMSRC(x) SIM_FIELD(x, 24, 0x3000000U)
+#define SIM_SOPT2_TPMSRC_MASK 0x3000000U
+#define SIM_SOPT2_PLLFLLSEL_MASK SIM_MASK(16)
+#define SIM_SCGC4_I2C0_MASK SIM_MASK(6)
+#define SIM_SCGC5_LPTMR_MASK SIM_MASK(0)
+#define SIM_SCGC5_PORTA_MASK SIM_MASK(9)
+#define SIM_SCGC5_PORTB_MASK SIM_MASK(10)
+#define SIM_SCGC5_PORTC_MASK SIM_MASK(11)
+#define SIM_SCGC5_PORTD_MASK SIM_MASK(12)
+#define SIM_SCGC5_PORTE_MASK SIM_MASK(13)
+#define SIM_SCGC6_TPM0_MASK SIM_MASK(24)
+#define SIM_SCGC6_TPM1_MASK SIM_MASK(25)
+#define SIM_SCGC6_TPM2_MASK SIM_MASK(26)
+#define SIM_SCGC6_RTC_MASK SIM_MASK(29)
+#define SIM_CLKDIV1_OUTDIV1_MASK 0xF0000000U
+#define SIM_CLKDIV1_OUTDIV1_SHIFT 28
+#define SIM_CLKDIV1_OUTDIV4_MASK 0x70000U
+#define SIM_CLKDIV1_OUTDIV4_SHIFT 16
+#define SIM_CLKDIV1_OUTDIV4(x) SIM_FIELD(x, 16, 0x70000U)
+
+#define PORT_PCR_PS_MASK SIM_MASK(0)
+#define PORT_PCR_PE_MASK SIM_MASK(1)
+#define PORT_PCR_ODE_MASK SIM_MASK(5)
+#define PORT_PCR_MUX(x) SIM_FIELD(x, 8, 0x700U)
+#define PORT_PCR_MUX_MASK 0x700U
+#define PORT_PCR_IRQC(x) SIM_FIELD(x, 16, 0xF0000U)
+#define PORT_PCR_IRQC_MASK 0xF0000U
+#define PORT_PCR_ISF_MASK SIM_MASK(24)
+
+#define I2C_F_ICR(x) SIM_FIELD(x, 0, 0x3FU)
+#define I2C_F_ICR_MASK 0x3FU
+#define I2C_F_MULT(x) SIM_FIELD(x, 6, 0xC0U)
+#define I2C_F_MULT_MASK 0xC0U
+#define I2C_F_MULT_SHIFT 6
+#define I2C_C1_DMAEN_MASK SIM_MASK(0)
+#define I2C_C1_WUEN_MASK SIM_MASK(1)
+#define I2C_C1_RSTA_MASK SIM_MASK(2)
+#define I2C_C1_TXAK_MASK SIM_MASK(3)
+#define I2C_C1_TX_MASK SIM_MASK(4)
+#define I2C_C1_MST_MASK SIM_MASK(5)
+#define I2C_C1_IICIE_MASK SIM_MASK(6)
+#define I2C_C1_IICEN_MASK SIM_MASK(7)
+#define I2C_S_RXAK_MASK SIM_MASK(0)
+#define I2C_S_IICIF_MASK SIM_MASK(1)
+#define I2C_S_ARBL_MASK SIM_MASK(4)
+#define I2C_S_BUSY_MASK SIM_MASK(5)
+#define I2C_S_TCF_MASK SIM_MASK(7)
+#define I2C_C2_HDRS_MASK SIM_MASK(5)
+#define I2C_FLT_FLT_MASK 0x1FU
+#define I2C_FLT_STOPIE_MASK SIM_MASK(5)
+#define I2C_FLT_STOPF_MASK SIM_MASK(6)
+
+#define LPTMR_CSR_TEN_MASK SIM_MASK(0)
+#define LPTMR_CSR_TIE_MASK SIM_MASK(6)
+#define LPTMR_CSR_TCF_MASK SIM_MASK(7)
+#define LPTMR_PSR_PCS(x) SIM_FIELD(x, 0, 0x3U)
+#define LPTMR_PSR_PBYP_MASK SIM_MASK(2)
+#define LPTMR_PSR_PRESCALE(x) SIM_FIELD(x, 3, 0x78U)
+#define LPTMR_CMR_COMPARE(x) SIM_FIELD(x, 0, 0xFFFFU)
+#define LPTMR_CNR_COUNTER_MASK 0xFFFFU
+
+#define SMC_PMPROT_AVLLS_MASK SIM_MASK(1)
+#define SMC_PMPROT_ALLS_MASK SIM_MASK(3)
+#define SMC_PMPROT_AVLP_MASK SIM_MASK(5)
+#define SMC_PMCTRL_STOPM(x) SIM_FIELD(x, 0, 0x7U)
+#define SMC_PMCTRL_STOPM_MASK 0x7U
+#define SMC_PMCTRL_STOPA_MASK SIM_MASK(3)
+#define SMC_PMCTRL_RUNM(x) SIM_FIELD(x, 5, 0x60U)
+#define SMC_STOPCTRL_VLLSM(x) SIM_FIELD(x, 0, 0x7U)
+#define SMC_STOPCTRL_VLLSM_MASK 0x7U
+#define SMC_STOPCTRL_PSTOPO(x) SIM_FIELD(x, 6, 0xC0U)
+#define SMC_PMSTAT_PMSTAT_MASK 0x7FU
+
+#define LLWU_PE1_WUPE0(x) SIM_FIELD(x, 0, 0x3U)
+#define LLWU_PE2_WUPE4(x) SIM_FIELD(x, 0, 0x3U)
+#define LLWU_PE2_WUPE5(x) SIM_FIELD(x, 2, 0xCU)
+#define LLWU_PE2_WUPE6(x) SIM_FIELD(x, 4, 0x30U)
+#define LLWU_PE2_WUPE7(x) SIM_FIELD(x, 6, 0xC0U)
+#define LLWU_PE3_WUPE8(x) SIM_FIELD(x, 0, 0x3U)
+#define LLWU_PE3_WUPE9(x) SIM_FIELD(x, 2, 0xCU)
+#define LLWU_PE3_WUPE10(x) SIM_FIELD(x, 4, 0x30U)
+#define LLWU_PE4_WUPE14(x) SIM_FIELD(x, 4, 0x30U)
+#define LLWU_PE4_WUPE15(x) SIM_FIELD(x, 6, 0xC0U)
+#define LLWU_ME_WUME0_MASK SIM_MASK(0)
+#define LLWU_F1_WUF5_MASK SIM_MASK(5)
+#define LLWU_F1_WUF6_MASK SIM_MASK(6)
+#define LLWU_F1_WUF7_MASK SIM_MASK(7)
+#define LLWU_F2_WUF14_MASK SIM_MASK(6)
+#define LLWU_F2_WUF15_MASK SIM_MASK(7)
+#define LLWU_F3_MWUF0_MASK SIM_MASK(0)
+
+#define PMC_REGSC_ACKISO_MASK SIM_MASK(3)
+
+#define RCM_SRS0_WAKEUP_MASK SIM_MASK(0)
+#define RCM_SRS0_LVD_MASK SIM_MASK(1)
+#define RCM_SRS0_PIN_MASK SIM_MASK(6)
+#define RCM_SRS0_POR_MASK SIM_MASK(7)
+
+#define TPM_SC_PS(x) SIM_FIELD(x, 0, 0x7U)
+#define TPM_SC_CMOD(x) SIM_FIELD(x, 3, 0x18U)
+#define TPM_SC_CMOD_MASK 0x18U
+#define TPM_SC_CPWMS_MASK SIM_MASK(5)
+#define TPM_SC_TOIE_MASK SIM_MASK(6)
+#define TPM_SC_TOF_MASK SIM_MASK(7)
+#define TPM_CnSC_ELSA_MASK SIM_MASK(2)
+#define TPM_CnSC_ELSB_MASK SIM_MASK(3)
+#define TPM_CnSC_MSA_MASK SIM_MASK(4)
+#define TPM_CnSC_MSB_MASK SIM_MASK(5)
+#define TPM_CnSC_CHIE_MASK SIM_MASK(6)
+#define TPM_CnSC_CHF_MASK SIM_MASK(7)
+#define TPM_CONF_DBGMODE(x) SIM_FIELD(x, 6, 0xC0U)
+#define TPM_CONF_CSOO_MASK SIM_MASK(16)
+#define TPM_CONF_TRGSEL(x) SIM_FIELD(x, 24, 0xF000000U)
+
+#define MCG_C1_IREFSTEN_MASK SIM_MASK(0)
+#define MCG_C1_IRCLKEN_MASK SIM_MASK(1)
+#define MCG_C2_IRCS_MASK SIM_MASK(0)
+
+#define RTC_SR_TIF_MASK SIM_MASK(0)
+#define RTC_SR_TOF_MASK SIM_MASK(1)
+#define RTC_SR_TCE_MASK SIM_MASK(4)
+
+#define SCB_SCR_SLEEPONEXIT_Msk SIM_MASK(1)
+#define SCB_SCR_SLEEPDEEP_Msk SIM_MASK(2)
+#define SCB_ICSR_PENDSTCLR_Msk SIM_MASK(25)
+#define SCB_ICSR_PENDSTSET_Msk SIM_MASK(26)
+
+#define SysTick_CTRL_ENABLE_Msk SIM_MASK(0)
+#define SysTick_CTRL_TICKINT_Msk SIM_MASK(1)
+#define SysTick_CTRL_CLKSOURCE_Msk SIM_MASK(2)
+#define SysTick_CTRL_COUNTFLAG_Msk SIM_MASK(16)
+#define SysTick_LOAD_RELOAD_Msk 0xFFFFFFU
+
+#endif
@@ -0,0 +1,5 @@
+/*----------------------------------------------------------------------------
+  Host stand-in for RTX's RTX_CM_lib.h, included at the end of RTX_Conf_CM.c.
+  On the board it instantiates the kernel's tables from the OS_ settings; the
+  compile check in Scripts/ only needs the settings to be consistent.
+ *----------------------------------------------------------------------------*/
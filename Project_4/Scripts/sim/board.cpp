@@ -0,0 +1,38 @@
+#include "sim.h"
+#include "board.h"
+#include "LEDs.h"
+#include "led_pulse.h"
+#include "activity.h"
+#include "events.h"
+
+SIM_LED_T Sim_LED;
+uint32_t Sim_Activity_Calls, Sim_Activity_Samples;
+
+static void Record_LED(unsigned int red_on, unsigned int green_on, unsigned int blue_on) {
+	if (!red_on && !green_on && !blue_on)
+		return;
+	Sim_LED.Red = red_on;
+	Sim_LED.Green = green_on;
+	Sim_LED.Blue = blue_on;
+	Sim_LED.Flashes++;
+}
+
+void Control_RGB_LEDs(unsigned int red_on, unsigned int green_on, unsigned int blue_on) {
+	Record_LED(red_on, green_on, blue_on);
+}
+
+void LED_Pulse(unsigned int red_on, unsigned int green_on, unsigned int blue_on, uint32_t us) {
+	(void) us;
+	Record_LED(red_on, green_on, blue_on);
+}
+
+void Update_Activity(int16_t acc[3], int num_samples) {
+	(void) acc;
+	Sim_Activity_Calls++;
+	Sim_Activity_Samples += num_samples;
+}
+
+uint32_t Get_Cycles(void) {
+	Sim_Step(SIM_GET_CYCLES_COST);
+	return (uint32_t) Sim_Now;
+}
@@ -0,0 +1,20 @@
+/*----------------------------------------------------------------------------
+  Board functions the tilt sources call, recorded instead of driven: the LED
+  colour of the last flash, and the FIFO blocks handed to Update_Activity.
+ *----------------------------------------------------------------------------*/
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <stdint.h>
+
+#define SIM_GET_CYCLES_COST (20)		// SysTick read with PRIMASK save/restore
+
+typedef struct {
+	unsigned int Red, Green, Blue;		// last colour flashed
+	uint32_t Flashes;
+} SIM_LED_T;
+
+extern SIM_LED_T Sim_LED;
+extern uint32_t Sim_Activity_Calls, Sim_Activity_Samples;
+
+#endif
@@ -0,0 +1,127 @@
+/*----------------------------------------------------------------------------
+  Host stand-in for the CMSIS-RTOS (RTX 4) API, for the USE_RTX compile check
+  in Scripts/ (make rtx). Declarations only, with the definition macros laid
+  out as in RTX's cmsis_os.h so osThreadDef, osMailQDef and osTimerDef expand
+  the way they do on the board. Nothing is linked against it.
+
+  Only what the firmware sources use is declared.
+ *----------------------------------------------------------------------------*/
+#ifndef CMSIS_OS_H_SIM
+#define CMSIS_OS_H_SIM
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define osCMSIS_RTX 0x40046
+
+typedef enum {
+	osPriorityIdle = -3,
+	osPriorityLow = -2,
+	osPriorityBelowNormal = -1,
+	osPriorityNormal = 0,
+	osPriorityAboveNormal = +1,
+	osPriorityHigh = +2,
+	osPriorityRealtime = +3,
+	osPriorityError = 0x84
+} osPriority;
+
+#define osWaitForever 0xFFFFFFFFU
+
+typedef enum {
+	osOK = 0,
+	osEventSignal = 0x08,
+	osEventMessage = 0x10,
+	osEventMail = 0x20,
+	osEventTimeout = 0x40,
+	osErrorParameter = 0x80,
+	osErrorResource = 0x81,
+	osErrorTimeoutResource = 0xC1,
+	osErrorISR = 0x82,
+	osErrorOS = 0xFF
+} osStatus;
+
+typedef enum {
+	osTimerOnce = 0,
+	osTimerPeriodic = 1
+} os_timer_type;
+
+typedef void (*os_pthread)(void const * argument);
+typedef void (*os_ptimer)(void const * argument);
+
+typedef struct os_thread_cb * osThreadId;
+typedef struct os_timer_cb * osTimerId;
+typedef struct os_mailQ_cb * osMailQId;
+
+typedef struct {
+	os_pthread pthread;
+	osPriority tpriority;
+	uint32_t instances;
+	uint32_t stacksize;					// bytes, 0 for OS_STKSIZE
+} osThreadDef_t;
+
+typedef struct {
+	os_ptimer ptimer;
+	void * timer;
+} osTimerDef_t;
+
+typedef struct {
+	uint32_t queue_sz;
+	uint32_t item_sz;
+	void * pool;
+} osMailQDef_t;
+
+typedef struct {
+	osStatus status;
+	union {
+		uint32_t v;
+		void * p;
+		int32_t signals;
+	} value;
+	union {
+		osMailQId mail_id;
+	} def;
+} osEvent;
+
+// Kernel
+osStatus osKernelInitialize(void);
+osStatus osKernelStart(void);
+uint32_t osKernelSysTick(void);
+#define osKernelSysTickFrequency 4000000
+
+// Threads
+#define osThreadDef(name, priority, instances, stacksz) \
+	const osThreadDef_t os_thread_def_##name = { (name), (priority), (instances), (stacksz) }
+#define osThread(name) &os_thread_def_##name
+osThreadId osThreadCreate(const osThreadDef_t * thread_def, void * argument);
+osThreadId osThreadGetId(void);
+osStatus osThreadTerminate(osThreadId thread_id);
+
+osStatus osDelay(uint32_t millisec);
+
+// Timers
+#define osTimerDef(name, function) \
+	uint32_t os_timer_cb_##name[6]; \
+	const osTimerDef_t os_timer_def_##name = { (function), ((void *) os_timer_cb_##name) }
+#define osTimer(name) &os_timer_def_##name
+osTimerId osTimerCreate(const osTimerDef_t * timer_def, os_timer_type type, void * argument);
+osStatus osTimerStart(osTimerId timer_id, uint32_t millisec);
+
+// Signals
+int32_t osSignalSet(osThreadId thread_id, int32_t signals);
+int32_t osSignalClear(osThreadId thread_id, int32_t signals);
+osEvent osSignalWait(int32_t signals, uint32_t millisec);
+
+// Mail queues
+#define osMailQDef(name, queue_sz, type) \
+	uint32_t os_mailQ_q_##name[4+(queue_sz)] = { 0 }; \
+	uint32_t os_mailQ_m_##name[3+((sizeof(type)+3)/4)*(queue_sz)]; \
+	void * os_mailQ_p_##name[2] = { (os_mailQ_q_##name), os_mailQ_m_##name }; \
+	const osMailQDef_t os_mailQ_def_##name = { (queue_sz), sizeof(type), (os_mailQ_p_##name) }
+#define osMailQ(name) &os_mailQ_def_##name
+osMailQId osMailCreate(const osMailQDef_t * queue_def, osThreadId thread_id);
+void * osMailAlloc(osMailQId queue_id, uint32_t millisec);
+osStatus osMailPut(osMailQId queue_id, void * mail);
+osEvent osMailGet(osMailQId queue_id, uint32_t millisec);
+osStatus osMailFree(osMailQId queue_id, void * mail);
+
+#endif
@@ -0,0 +1,200 @@
+#include "mma8451_model.h"
+#include "mma8451.h"
+#include <math.h>
+#include <string.h>
+
+#define SIM_MMA_MAX_CATCH_UP (4*SIM_MMA_FIFO_SIZE)	// samples made at once after a long gap
+
+// CTRL1_DR code to output data rate in 0.01 Hz
+static const uint32_t odr_chz[8] = {80000, 40000, 20000, 10000, 5000, 1250, 625, 156};
+
+Sim_MMA8451::Sim_MMA8451() : Sim_I2C_Device(MMA_ADDR) {
+	memset(regs_, 0, sizeof(regs_));
+	regs_[REG_WHOAMI] = WHOAMI;
+	memset(now_, 0, sizeof(now_));
+	now_[2] = 4096;
+	fifo_head_ = fifo_count_ = 0;
+	overflow_ = false;
+	next_sample_at_ = 0;
+	adx_ = 0;
+	adx_set_ = false;
+	Samples_Made = Samples_Read = Overflows = Ignored_Writes = 0;
+}
+
+// Gravity seen by the sensor for roll about X and pitch about Y
+void Sim_MMA8451::Set_Tilt(double roll_deg, double pitch_deg) {
+	double roll = roll_deg*M_PI/180, pitch = pitch_deg*M_PI/180;
+
+	Set_Counts((int16_t) lround(4096*sin(pitch)),
+		(int16_t) lround(4096*cos(pitch)*sin(roll)),
+		(int16_t) lround(4096*cos(pitch)*cos(roll)));
+}
+
+void Sim_MMA8451::Set_Counts(int16_t x, int16_t y, int16_t z) {
+	int16_t c[3] = {x, y, z};
+	int i;
+
+	Update();												// samples so far were of the old position
+	for (i = 0; i < 3; i++)
+		now_[i] = c[i] > 8191 ? 8191 : c[i] < -8192 ? -8192 : c[i];
+}
+
+uint8_t Sim_MMA8451::Reg(uint8_t adx) {
+	return regs_[adx];
+}
+
+int Sim_MMA8451::FIFO_Count(void) {
+	Update();
+	return fifo_count_;
+}
+
+bool Sim_MMA8451::Fifo_On(void) {
+	return (regs_[REG_F_SETUP] & (F_SETUP_MODE_CIRCULAR | F_SETUP_MODE_FILL)) != 0;
+}
+
+bool Sim_MMA8451::Active(void) {
+	return (regs_[REG_CTRL1] & CTRL1_ACTIVE) != 0;
+}
+
+uint32_t Sim_MMA8451::Sample_Cycles(void) {
+	return (uint32_t) ((uint64_t) SIM_CORE_HZ*100/odr_chz[(regs_[REG_CTRL1] >> 3) & 0x07]);
+}
+
+// Make the samples due by now
+void Sim_MMA8451::Update(void) {
+	int n = 0;
+
+	if (!Active())
+		return;
+	while (next_sample_at_ <= Sim_Now) {
+		if (++n > SIM_MMA_MAX_CATCH_UP) {	// FIFO long full: skip ahead
+			next_sample_at_ = Sim_Now + Sample_Cycles();
+			break;
+		}
+		Push_Sample();
+		next_sample_at_ += Sample_Cycles();
+	}
+}
+
+void Sim_MMA8451::Push_Sample(void) {
+	int i;
+	uint16_t v;
+
+	Samples_Made++;
+	for (i = 0; i < 3; i++) {							// OUT registers: 14 bits, left justified
+		v = (uint16_t) (now_[i] << 2);
+		regs_[REG_XHI + 2*i] = v >> 8;
+		regs_[REG_XLO + 2*i] = v & 0xFC;
+	}
+	if (!Fifo_On())
+		return;
+	if (fifo_count_ == SIM_MMA_FIFO_SIZE) {
+		overflow_ = true;
+		Overflows++;
+		if (regs_[REG_F_SETUP] & F_SETUP_MODE_FILL)
+			return;														// fill mode stops accepting
+		fifo_head_ = (fifo_head_ + 1) % SIM_MMA_FIFO_SIZE;
+		fifo_count_--;
+	}
+	memcpy(fifo_[(fifo_head_ + fifo_count_) % SIM_MMA_FIFO_SIZE], now_, sizeof(now_));
+	fifo_count_++;
+}
+
+bool Sim_MMA8451::Start(bool read) {
+	Update();
+	if (!read)
+		adx_set_ = false;
+	return true;
+}
+
+bool Sim_MMA8451::Write(uint8_t data) {
+	uint8_t adx = adx_;
+
+	if (!adx_set_) {
+		adx_ = data;
+		adx_set_ = true;
+		return true;
+	}
+	adx_ = (adx_ + 1) % SIM_MMA_REGS;
+	if (adx >= SIM_MMA_REGS)
+		return true;
+	if (adx == REG_CTRL1) {
+		if (Active() && (data & CTRL1_ACTIVE)) {
+			if (data != regs_[REG_CTRL1])
+				Ignored_Writes++;								// only ACTIVE can change while active
+			return true;
+		}
+		if (!Active() && (data & CTRL1_ACTIVE)) {
+			regs_[REG_CTRL1] = data;
+			next_sample_at_ = Sim_Now + Sample_Cycles();
+			return true;
+		}
+		regs_[REG_CTRL1] = data;
+		return true;
+	}
+	if ((adx <= REG_ZLO) || (adx == REG_WHOAMI) || (adx == REG_FF_MT_SRC) || (adx == REG_TRANSIENT_SRC))
+		return true;												// read only
+	if (Active()) {
+		if (data != regs_[adx])
+			Ignored_Writes++;
+		return true;
+	}
+	regs_[adx] = data;
+	if (adx == REG_F_SETUP)
+		fifo_head_ = fifo_count_ = 0;				// mode change flushes the FIFO
+	return true;
+}
+
+// Address auto-increment. F_READ skips the LSB registers; with the FIFO on,
+// the last data register wraps back to XHI for the next sample.
+void Sim_MMA8451::Next_Adx(void) {
+	bool fast = (regs_[REG_CTRL1] & CTRL1_F_READ) != 0;
+	uint8_t last = fast ? REG_ZHI : REG_ZLO;
+
+	if ((adx_ >= REG_XHI) && (adx_ <= REG_ZLO)) {
+		if (adx_ >= last)
+			adx_ = Fifo_On() ? REG_XHI : REG_ZLO + 1;
+		else
+			adx_ += fast ? 2 : 1;
+	} else {
+		adx_ = (adx_ + 1) % SIM_MMA_REGS;
+	}
+}
+
+uint8_t Sim_MMA8451::Read(void) {
+	uint8_t adx = adx_, value, last;
+	uint16_t v;
+
+	Next_Adx();
+	if (adx >= SIM_MMA_REGS)
+		return 0;
+	if (adx == REG_F_STATUS) {
+		if (!Fifo_On())
+			return 0x0F;											// STATUS: new X, Y, Z data
+		value = fifo_count_;
+		if (overflow_)
+			value |= F_STATUS_OVF;
+		if (F_SETUP_WMRK(regs_[REG_F_SETUP]) && (fifo_count_ >= F_SETUP_WMRK(regs_[REG_F_SETUP])))
+			value |= F_STATUS_WMRK;
+		return value;
+	}
+	if ((adx < REG_XHI) || (adx > REG_ZLO))
+		return regs_[adx];
+
+	last = (regs_[REG_CTRL1] & CTRL1_F_READ) ? REG_ZHI : REG_ZLO;
+	if (!Fifo_On() || (fifo_count_ == 0)) {
+		value = regs_[adx];
+		if (adx == last)
+			Samples_Read++;
+		return value;
+	}
+	v = (uint16_t) (fifo_[fifo_head_][(adx - REG_XHI)/2] << 2);
+	value = ((adx - REG_XHI) & 1) ? (v & 0xFC) : (v >> 8);
+	if (adx == last) {												// sample fully read: pop it
+		fifo_head_ = (fifo_head_ + 1) % SIM_MMA_FIFO_SIZE;
+		fifo_count_--;
+		overflow_ = false;
+		Samples_Read++;
+	}
+	return value;
+}
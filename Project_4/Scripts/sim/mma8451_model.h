@@ -0,0 +1,47 @@
+/*----------------------------------------------------------------------------
+  MMA8451Q register model on the simulated I2C0 bus. Produces samples at the
+  CTRL1 data rate from a set tilt, with the FIFO (F_SETUP, F_STATUS), F_READ
+  auto-increment and the standby-only register rules of the datasheet.
+  The motion engines are not modelled.
+ *----------------------------------------------------------------------------*/
+#ifndef MMA8451_MODEL_H
+#define MMA8451_MODEL_H
+
+#include "sim.h"
+
+#define SIM_MMA_REGS (0x32)
+#define SIM_MMA_FIFO_SIZE (32)
+
+class Sim_MMA8451 : public Sim_I2C_Device {
+public:
+	Sim_MMA8451();
+	void Set_Tilt(double roll_deg, double pitch_deg);
+	void Set_Counts(int16_t x, int16_t y, int16_t z);	// 4096/g, 14 bits
+	uint8_t Reg(uint8_t adx);											// peek, no side effects
+	int FIFO_Count(void);
+
+	bool Start(bool read);
+	bool Write(uint8_t data);
+	uint8_t Read(void);
+
+	uint32_t Samples_Made, Samples_Read, Overflows;
+	uint32_t Ignored_Writes;			// config writes while ACTIVE, which the part drops
+private:
+	void Update(void);
+	void Push_Sample(void);
+	void Next_Adx(void);
+	bool Fifo_On(void);
+	bool Active(void);
+	uint32_t Sample_Cycles(void);
+
+	uint8_t regs_[SIM_MMA_REGS];
+	int16_t now_[3];							// acceleration the sensor feels
+	int16_t fifo_[SIM_MMA_FIFO_SIZE][3];
+	int fifo_head_, fifo_count_;
+	bool overflow_;
+	uint64_t next_sample_at_;
+	uint8_t adx_;
+	bool adx_set_;								// first byte of a write is the register address
+};
+
+#endif
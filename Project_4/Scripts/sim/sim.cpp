@@ -0,0 +1,467 @@
+/*----------------------------------------------------------------------------
+  KL25Z core, NVIC and I2C0 master model for the host builds (see sim.h).
+
+  I2C0 follows the reference manual closely enough to catch the mistakes
+  that hang or corrupt a real bus: a byte takes 9 SCL periods at the rate
+  set in F; IICIF and TCF are set when it finishes; a START while the bus
+  is busy (including the STOP hold time after our own STOP) loses
+  arbitration; STOP sets FLT[STOPF] once the bus is free. Accesses the
+  hardware would garble are counted in Sim_I2C_Stats.Violations.
+ *----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sim.h"
+
+#define I2C_SCL_POS (24)
+#define I2C_SDA_POS (25)
+#define SIM_MAX_DEVICES (4)
+#define SIM_IRQ_ENTRY_CYCLES (15)		// Cortex-M0+ exception entry and exit
+#define SIM_MAX_ISR_RUNS (100000)		// back to back: the ISR never clears IICIF
+
+uint64_t Sim_Now;
+uint32_t SystemCoreClock;
+SIM_I2C_STATS_T Sim_I2C_Stats;
+
+SIM_Type Sim_SIM;
+PORT_Type Sim_PORTA, Sim_PORTB, Sim_PORTC, Sim_PORTD, Sim_PORTE;
+GPIO_Type Sim_PTA, Sim_PTB, Sim_PTC, Sim_PTD, Sim_PTE;
+I2C_Type Sim_I2C0 = {
+	Sim_I2C_Reg(0), Sim_I2C_Reg(1), Sim_I2C_Reg(2), Sim_I2C_Reg(3), Sim_I2C_Reg(4), Sim_I2C_Reg(5),
+	Sim_I2C_Reg(6), Sim_I2C_Reg(7), Sim_I2C_Reg(8), Sim_I2C_Reg(9), Sim_I2C_Reg(10), Sim_I2C_Reg(11)
+};
+LPTMR_Type Sim_LPTMR0;
+SMC_Type Sim_SMC;
+LLWU_Type Sim_LLWU;
+PMC_Type Sim_PMC;
+RCM_Type Sim_RCM;
+TPM_Type Sim_TPM0, Sim_TPM1, Sim_TPM2;
+MCG_Type Sim_MCG;
+RTC_Type Sim_RTC;
+SCB_Type Sim_SCB;
+SysTick_Type Sim_SysTick;
+
+enum {REG_A1, REG_F, REG_C1, REG_S, REG_D, REG_C2, REG_FLT, REG_COUNT = 12};
+enum {PH_IDLE, PH_ADDR, PH_WRITE, PH_READ, PH_NOBODY};
+
+// Same divider table as i2c.c: SCL = bus/(2^MULT * scl_div[ICR])
+static const uint16_t scl_div[64] = {
+	20, 22, 24, 26, 28, 30, 34, 40, 28, 32, 36, 40, 44, 48, 56, 68,
+	48, 56, 64, 72, 80, 88, 104, 128, 80, 96, 112, 128, 144, 160, 192, 240,
+	160, 192, 224, 256, 288, 320, 384, 480, 320, 384, 448, 512, 576, 640, 768, 960,
+	640, 768, 896, 1024, 1152, 1280, 1536, 1920, 1280, 1536, 1792, 2048, 2304, 2560, 3072, 3840
+};
+
+static uint32_t primask;
+static uint32_t nvic_enabled;					// ISER bits; only I2C0 is taken here
+static bool irq_enabled, irq_pending, in_isr;
+
+static struct {
+	uint8_t reg[REG_COUNT];					// S without BUSY, D is the received byte
+	int phase;
+	bool bus_busy;									// START seen, STOP hold not yet over
+	uint64_t bus_free_at;						// end of STOP hold, 0 if no STOP under way
+	bool byte_busy;
+	bool byte_rx;
+	uint8_t byte_tx;
+	uint64_t byte_done_at;
+	bool nacked;										// master NACKed the last byte read
+	Sim_I2C_Device * dev;						// addressed device
+} i2c;
+
+static Sim_I2C_Device * devices[SIM_MAX_DEVICES];
+static int num_devices;
+
+static void Violation(const char * what) {
+	Sim_I2C_Stats.Violations++;
+	if (getenv("SIM_VERBOSE"))
+		fprintf(stderr, "sim: %s at cycle %llu\n", what, (unsigned long long) Sim_Now);
+}
+
+static uint32_t SCL_Period_Cycles(void) {
+	uint32_t outdiv4 = (Sim_SIM.CLKDIV1 & SIM_CLKDIV1_OUTDIV4_MASK) >> SIM_CLKDIV1_OUTDIV4_SHIFT;
+	uint32_t mult = (i2c.reg[REG_F] & I2C_F_MULT_MASK) >> I2C_F_MULT_SHIFT;
+
+	// core cycles per bus clock times bus clocks per SCL period
+	return (outdiv4 + 1)*(1UL << (mult > 2 ? 2 : mult))*scl_div[i2c.reg[REG_F] & I2C_F_ICR_MASK];
+}
+
+static bool I2C_IRQ_Line(void) {
+	uint8_t c1 = i2c.reg[REG_C1];
+
+	return (c1 & I2C_C1_IICEN_MASK) && (c1 & I2C_C1_IICIE_MASK) && (i2c.reg[REG_S] & I2C_S_IICIF_MASK);
+}
+
+static void Take_Interrupts(void) {
+	uint64_t entry;
+	uint32_t runs = 0;
+
+	if (!in_isr && I2C_IRQ_Line())		// while active, only the line at exit counts
+		irq_pending = true;
+	while (irq_pending && irq_enabled && !primask && !in_isr) {
+		if (++runs > SIM_MAX_ISR_RUNS) {
+			fprintf(stderr, "sim: I2C0_IRQHandler does not clear IICIF\n");
+			exit(2);
+		}
+		irq_pending = false;
+		in_isr = true;
+		entry = Sim_Now;
+		Sim_Now += SIM_IRQ_ENTRY_CYCLES;
+		Sim_I2C_Stats.Interrupts++;
+		I2C0_IRQHandler();
+		if (Sim_Now - entry > Sim_I2C_Stats.Max_ISR_Cycles)
+			Sim_I2C_Stats.Max_ISR_Cycles = (uint32_t) (Sim_Now - entry);
+		in_isr = false;
+		if (I2C_IRQ_Line())
+			irq_pending = true;
+	}
+}
+
+// Addressed device for an address byte, 0 if nothing answers
+static Sim_I2C_Device * Find_Device(uint8_t adx) {
+	int i;
+
+	for (i = 0; i < num_devices; i++) {
+		if (devices[i]->Present && (devices[i]->Address == (adx & 0xFE)))
+			return devices[i];
+	}
+	return 0;
+}
+
+static void Byte_Done(void) {
+	bool ack = false;
+
+	i2c.byte_busy = false;
+	Sim_I2C_Stats.Wire_Bytes++;
+	if (!i2c.byte_rx) {
+		switch (i2c.phase) {
+			case PH_ADDR:
+				i2c.dev = Find_Device(i2c.byte_tx);
+				ack = i2c.dev && i2c.dev->Start(i2c.byte_tx & 0x01);
+				if (!ack)
+					i2c.dev = 0;
+				i2c.phase = !ack ? PH_NOBODY : (i2c.byte_tx & 0x01) ? PH_READ : PH_WRITE;
+				break;
+			case PH_WRITE:
+				ack = i2c.dev->Write(i2c.byte_tx);
+				break;
+			default:
+				Violation("byte written in a read or to nobody");
+				break;
+		}
+		if (ack)
+			i2c.reg[REG_S] &= ~I2C_S_RXAK_MASK;
+		else
+			i2c.reg[REG_S] |= I2C_S_RXAK_MASK;
+	} else {
+		if ((i2c.phase == PH_READ) && i2c.dev) {
+			i2c.reg[REG_D] = i2c.dev->Read();
+			if (i2c.reg[REG_C1] & I2C_C1_TXAK_MASK) {
+				i2c.dev->Nack();
+				i2c.nacked = true;
+			}
+		} else {
+			i2c.reg[REG_D] = 0xFF;					// nobody drives SDA
+		}
+	}
+	i2c.reg[REG_S] |= I2C_S_TCF_MASK | I2C_S_IICIF_MASK;
+}
+
+static void Bus_Free(void) {
+	i2c.bus_busy = false;
+	i2c.bus_free_at = 0;
+	i2c.reg[REG_FLT] |= I2C_FLT_STOPF_MASK;
+	if (i2c.reg[REG_FLT] & I2C_FLT_STOPIE_MASK)
+		i2c.reg[REG_S] |= I2C_S_IICIF_MASK;
+}
+
+// Time of the next bus event, 0 if none is due
+static uint64_t Next_Event(void) {
+	uint64_t t = 0;
+
+	if (i2c.byte_busy)
+		t = i2c.byte_done_at;
+	if (i2c.bus_free_at && (!t || (i2c.bus_free_at < t)))
+		t = i2c.bus_free_at;
+	return t;
+}
+
+static void Run_Until(uint64_t until) {
+	uint64_t t;
+
+	Take_Interrupts();
+	while ((t = Next_Event()) && (t <= until)) {
+		if (t > Sim_Now)
+			Sim_Now = t;
+		if (i2c.byte_busy && (i2c.byte_done_at <= Sim_Now))
+			Byte_Done();
+		if (i2c.bus_free_at && (i2c.bus_free_at <= Sim_Now))
+			Bus_Free();
+		Take_Interrupts();
+	}
+	if (until > Sim_Now)
+		Sim_Now = until;
+}
+
+static void Begin_Byte(bool rx, uint8_t data) {
+	i2c.byte_busy = true;
+	i2c.byte_rx = rx;
+	i2c.byte_tx = data;
+	i2c.byte_done_at = Sim_Now + 9*SCL_Period_Cycles();
+	i2c.reg[REG_S] &= ~I2C_S_TCF_MASK;
+}
+
+static void Bus_Reset(void) {
+	i2c.phase = PH_IDLE;
+	i2c.bus_busy = false;
+	i2c.bus_free_at = 0;
+	i2c.byte_busy = false;
+	i2c.nacked = false;
+	i2c.dev = 0;
+}
+
+static void Start(bool repeated) {
+	if (i2c.byte_busy)
+		Violation("START during a byte");
+	if (!repeated && i2c.bus_busy) {
+		i2c.reg[REG_S] |= I2C_S_ARBL_MASK | I2C_S_IICIF_MASK;
+		i2c.reg[REG_C1] &= ~I2C_C1_MST_MASK;
+		Sim_I2C_Stats.Arb_Lost++;
+		return;
+	}
+	if (repeated && !i2c.bus_busy)
+		Violation("repeated START on an idle bus");
+	i2c.bus_busy = true;
+	i2c.bus_free_at = 0;
+	i2c.phase = PH_ADDR;
+	i2c.nacked = false;
+	i2c.byte_busy = false;
+	Sim_I2C_Stats.Starts++;
+}
+
+static void Stop(void) {
+	if (i2c.byte_busy) {
+		Violation("STOP during a byte");
+		i2c.byte_busy = false;
+	}
+	if (i2c.dev)
+		i2c.dev->Stop();
+	i2c.phase = PH_IDLE;
+	i2c.dev = 0;
+	i2c.bus_free_at = Sim_Now + SCL_Period_Cycles();
+	Sim_I2C_Stats.Stops++;
+}
+
+static void Write_C1(uint8_t value) {
+	uint8_t old = i2c.reg[REG_C1];
+
+	i2c.reg[REG_C1] = value & ~I2C_C1_RSTA_MASK;
+	if (!(value & I2C_C1_IICEN_MASK)) {
+		Bus_Reset();
+		return;
+	}
+	if (!(old & I2C_C1_MST_MASK) && (value & I2C_C1_MST_MASK))
+		Start(false);
+	else if ((old & I2C_C1_MST_MASK) && !(value & I2C_C1_MST_MASK))
+		Stop();
+	else if ((value & I2C_C1_MST_MASK) && (value & I2C_C1_RSTA_MASK))
+		Start(true);
+}
+
+static void Write_D(uint8_t value) {
+	uint8_t c1 = i2c.reg[REG_C1];
+
+	if (!(c1 & I2C_C1_MST_MASK) || !(c1 & I2C_C1_TX_MASK))
+		return;
+	if (i2c.byte_busy) {
+		Violation("D written during a byte");
+		return;
+	}
+	Begin_Byte(false, value);
+}
+
+static uint8_t Read_D(void) {
+	uint8_t c1 = i2c.reg[REG_C1];
+
+	if ((c1 & I2C_C1_MST_MASK) && !(c1 & I2C_C1_TX_MASK)) {
+		if (i2c.byte_busy)
+			Violation("D read during a byte");
+		else if (i2c.nacked)
+			Violation("byte read after NACK");
+		else
+			Begin_Byte(true, 0);
+	}
+	return i2c.reg[REG_D];
+}
+
+static uint8_t Read_Reg(uint8_t offset) {
+	uint8_t value = i2c.reg[offset];
+
+	if ((offset == REG_S) && i2c.bus_busy)
+		value |= I2C_S_BUSY_MASK;
+	return value;
+}
+
+static void Write_Reg(uint8_t offset, uint8_t value) {
+	if (getenv("SIM_TRACE")) fprintf(stderr, "%llu W%d %02X isr%d busy%d\n", (unsigned long long)Sim_Now, offset, value, in_isr, i2c.byte_busy);
+	switch (offset) {
+		case REG_C1:
+			Write_C1(value);
+			break;
+		case REG_S:										// IICIF and ARBL are write 1 to clear
+			i2c.reg[REG_S] &= ~(value & (I2C_S_IICIF_MASK | I2C_S_ARBL_MASK));
+			break;
+		case REG_D:
+			Write_D(value);
+			break;
+		case REG_FLT:									// STOPF is write 1 to clear
+			i2c.reg[REG_FLT] = (value & ~I2C_FLT_STOPF_MASK) |
+				(i2c.reg[REG_FLT] & I2C_FLT_STOPF_MASK & ~value);
+			break;
+		default:
+			i2c.reg[offset] = value;
+			break;
+	}
+}
+
+Sim_I2C_Reg::operator uint8_t() {
+	Sim_Step(SIM_REG_CYCLES);
+	uint8_t v = (offset_ == REG_D) ? Read_D() : Read_Reg(offset_);
+	if (getenv("SIM_TRACE")) fprintf(stderr, "%llu R%d %02X isr%d busy%d\n", (unsigned long long)Sim_Now, offset_, v, in_isr, i2c.byte_busy);
+	return v;
+}
+
+Sim_I2C_Reg & Sim_I2C_Reg::operator=(uint32_t value) {
+	Sim_Step(SIM_REG_CYCLES);
+	Write_Reg(offset_, (uint8_t) value);
+	Take_Interrupts();
+	return *this;
+}
+
+// Read-modify-write as the compiled code does it: write 1 to clear flags
+// that happen to be set are cleared too
+Sim_I2C_Reg & Sim_I2C_Reg::operator|=(uint32_t value) {
+	Sim_Step(SIM_REG_CYCLES);
+	Write_Reg(offset_, (uint8_t) (Read_Reg(offset_) | value));
+	Take_Interrupts();
+	return *this;
+}
+
+Sim_I2C_Reg & Sim_I2C_Reg::operator&=(uint32_t value) {
+	Sim_Step(SIM_REG_CYCLES);
+	Write_Reg(offset_, (uint8_t) (Read_Reg(offset_) & value));
+	Take_Interrupts();
+	return *this;
+}
+
+void Sim_Step(uint32_t cycles) {
+	Run_Until(Sim_Now + cycles);
+}
+
+void Sim_Idle_us(uint32_t us) {
+	Run_Until(Sim_Now + (uint64_t) us*SystemCoreClock/1000000);
+}
+
+void Sim_Reset(void) {
+	Sim_Now = 0;
+	SystemCoreClock = SIM_CORE_HZ;
+	memset(&Sim_I2C_Stats, 0, sizeof(Sim_I2C_Stats));
+	memset(&i2c, 0, sizeof(i2c));
+	Bus_Reset();
+	num_devices = 0;
+	primask = 0;
+	nvic_enabled = 0;
+	irq_enabled = irq_pending = in_isr = false;
+	memset(&Sim_SIM, 0, sizeof(Sim_SIM));
+	Sim_SIM.CLKDIV1 = SIM_CLKDIV1_OUTDIV4(SIM_OUTDIV4);
+	memset(&Sim_PTE, 0, sizeof(Sim_PTE));
+	memset(&Sim_LLWU, 0, sizeof(Sim_LLWU));
+	Sim_PTE.PDIR = (1UL << I2C_SCL_POS) | (1UL << I2C_SDA_POS);	// pulled up, nobody holding them
+}
+
+void Sim_I2C_Attach(Sim_I2C_Device * dev) {
+	if (num_devices < SIM_MAX_DEVICES)
+		devices[num_devices++] = dev;
+}
+
+void NVIC_SetPriority(IRQn_Type irq, uint32_t priority) {
+	(void) irq;
+	(void) priority;
+}
+
+void NVIC_EnableIRQ(IRQn_Type irq) {
+	if (irq >= 0)
+		nvic_enabled |= 1UL << irq;
+	if (irq == I2C0_IRQn) {
+		irq_enabled = true;
+		Take_Interrupts();
+	}
+}
+
+void NVIC_DisableIRQ(IRQn_Type irq) {
+	if (irq >= 0)
+		nvic_enabled &= ~(1UL << irq);
+	if (irq == I2C0_IRQn)
+		irq_enabled = false;
+}
+
+bool Sim_IRQ_Enabled(IRQn_Type irq) {
+	return (irq >= 0) && (nvic_enabled & (1UL << irq));
+}
+
+void NVIC_ClearPendingIRQ(IRQn_Type irq) {
+	if (irq == I2C0_IRQn)
+		irq_pending = false;
+}
+
+// Sleep until an interrupt is pending (taken at once if PRIMASK is clear),
+// or for a SysTick wrap if no bus event is coming
+void __wfi(void) {
+	uint32_t taken = Sim_I2C_Stats.Interrupts;
+	uint64_t t;
+
+	Sim_I2C_Stats.Wfi++;
+	if (I2C_IRQ_Line())
+		irq_pending = true;
+	while (!(irq_pending && irq_enabled) && (Sim_I2C_Stats.Interrupts == taken)) {
+		t = Next_Event();
+		if (!t) {
+			Sim_Now += SIM_WFI_IDLE_CYCLES;
+			return;
+		}
+		Run_Until(t);
+	}
+}
+
+void __enable_irq(void) {
+	primask = 0;
+	Take_Interrupts();
+}
+
+void __disable_irq(void) {
+	primask = 1;
+}
+
+uint32_t __get_PRIMASK(void) {
+	return primask;
+}
+
+void __set_PRIMASK(uint32_t value) {
+	primask = value & 1;
+	if (!primask)
+		Take_Interrupts();
+}
+
+uintptr_t __get_PSP(void) {
+	return 0;
+}
+
+void __nop(void) {
+	Sim_Now++;
+}
+
+void __DSB(void) {
+}
+
+void __ISB(void) {
+}
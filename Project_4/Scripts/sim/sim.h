@@ -0,0 +1,65 @@
+/*----------------------------------------------------------------------------
+  Host simulation of the KL25Z core clock, PRIMASK/NVIC for I2C0 and the I2C0
+  master with devices on its bus. Time is counted in core clock cycles and
+  moves on with every I2C0 register access, Get_Cycles call and __wfi, which
+  is also when a pending I2C0 interrupt is taken.
+ *----------------------------------------------------------------------------*/
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include "MKL25Z4.h"
+
+#define SIM_CORE_HZ (4000000UL)		// CLOCK_SETUP 2: BLPI, 4 MHz core
+#define SIM_OUTDIV4 (4)						// 800 kHz bus clock
+#define SIM_REG_CYCLES (2)				// cost of one I2C0 register access
+#define SIM_WFI_IDLE_CYCLES (1UL << 24)	// __wfi with nothing due: SysTick wrap
+
+extern uint64_t Sim_Now;
+
+// Things the firmware did that real hardware would not have tolerated
+typedef struct {
+	uint32_t Wire_Bytes;			// bytes clocked on the bus, address bytes included
+	uint32_t Starts;					// START and repeated START
+	uint32_t Stops;
+	uint32_t Arb_Lost;				// START while the bus was still busy, and the like
+	uint32_t Violations;			// D accessed mid-byte, STOP mid-byte, read after NACK...
+	uint32_t Interrupts;			// I2C0_IRQHandler entries
+	uint32_t Max_ISR_Cycles;	// longest I2C0_IRQHandler run
+	uint32_t Wfi;
+} SIM_I2C_STATS_T;
+
+extern SIM_I2C_STATS_T Sim_I2C_Stats;
+
+// A device on the simulated bus. Called when each byte finishes.
+class Sim_I2C_Device {
+public:
+	explicit Sim_I2C_Device(uint8_t address) : Address(address), Present(true) {}
+	virtual ~Sim_I2C_Device() {}
+	virtual bool Start(bool read) = 0;		// addressed: true to acknowledge
+	virtual bool Write(uint8_t data) = 0;	// byte from the master: true to acknowledge
+	virtual uint8_t Read(void) = 0;				// next byte to the master
+	virtual void Nack(void) {}						// master did not acknowledge the last byte read
+	virtual void Stop(void) {}
+	uint8_t Address;											// 8-bit form, R/W bit clear
+	bool Present;													// false: nothing answers at Address
+};
+
+// Reset time, registers, devices and statistics
+void Sim_Reset(void);
+void Sim_I2C_Attach(Sim_I2C_Device * dev);
+
+// Let time pass as if the core were running or sleeping: hardware events
+// happen and interrupts are taken
+void Sim_Step(uint32_t cycles);
+void Sim_Idle_us(uint32_t us);
+
+// NVIC enable state of any interrupt, as the firmware left it
+bool Sim_IRQ_Enabled(IRQn_Type irq);
+
+// Firmware ISRs: I2C0 in i2c.c, PORTD and LLWU in mma_int.c
+void I2C0_IRQHandler(void);
+void PORTD_IRQHandler(void);
+void LLWU_IRQHandler(void);
+
+#endif
@@ -0,0 +1,235 @@
+/*----------------------------------------------------------------------------
+  Host test of the I2C transaction queue (i2c.c) with two devices on the
+  simulated bus: the MMA8451 model and a plain register device standing in
+  for a magnetometer. Checks that queued transfers from several clients run
+  back to back from the interrupt with no waiting in the ISR, that polled
+  calls wait for the queue to drain, that transfers submitted while a
+  polled one owns the bus start after it, and that polled retries are
+  counted.
+ *----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <string.h>
+#include "sim.h"
+#include "mma8451_model.h"
+#include "config.h"
+#include "i2c.h"
+#include "mma8451.h"
+
+#define MAG_ADDR (0x1C)
+#define ABSENT_ADDR (0x3C)
+#define MAG_REGS (16)
+#define MAX_XFERS (8)
+
+static int checks, failures;
+
+#define CHECK(cond, ...) do { \
+	checks++; \
+	if (!(cond)) { \
+		failures++; \
+		printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+		printf(__VA_ARGS__); \
+		printf("\n"); \
+	} \
+} while (0)
+
+// Second device: registers with auto-increment. On_Start runs once the next
+// time it is addressed, as a higher priority ISR submitting a transfer would.
+class Reg_Device : public Sim_I2C_Device {
+public:
+	explicit Reg_Device(uint8_t address) : Sim_I2C_Device(address), On_Start(0), adx_(0), adx_set_(false) {
+		for (int i = 0; i < MAG_REGS; i++)
+			Regs[i] = 0xA0 + i;
+	}
+	bool Start(bool read) {
+		void (* hook)(void) = On_Start;
+
+		On_Start = 0;
+		if (hook)
+			hook();
+		if (!read)
+			adx_set_ = false;
+		return true;
+	}
+	bool Write(uint8_t data) {
+		if (!adx_set_) {
+			adx_ = data % MAG_REGS;
+			adx_set_ = true;
+		} else {
+			Regs[adx_] = data;
+			adx_ = (adx_ + 1) % MAG_REGS;
+		}
+		return true;
+	}
+	uint8_t Read(void) {
+		uint8_t value = Regs[adx_];
+
+		adx_ = (adx_ + 1) % MAG_REGS;
+		return value;
+	}
+	uint8_t Regs[MAG_REGS];
+	void (* On_Start)(void);
+private:
+	uint8_t adx_;
+	bool adx_set_;
+};
+
+static Sim_MMA8451 mma;
+static Reg_Device mag(MAG_ADDR);
+
+static I2C_XFER_T xfers[MAX_XFERS];
+static uint8_t bufs[MAX_XFERS][8];
+static int done_order[MAX_XFERS], num_done;
+
+static void Done(I2C_XFER_T * xfer) {
+	done_order[num_done++] = xfer - xfers;
+}
+
+static I2C_XFER_T * Make_Xfer(int i, uint8_t dev_adx, uint8_t reg_adx, uint8_t count, uint8_t read) {
+	I2C_XFER_T * xfer = &xfers[i];
+
+	xfer->Dev_Adx = dev_adx;
+	xfer->Reg_Adx = reg_adx;
+	xfer->Data = bufs[i];
+	xfer->Count = count;
+	xfer->Read = read;
+	xfer->Callback = Done;
+	xfer->Status = I2C_OK;
+	return xfer;
+}
+
+static uint32_t SCL_Cycles(void) {
+	return SystemCoreClock/I2C_Speed.SCL_Hz;
+}
+
+// Four transfers for two devices from two clients, queued at once
+static void Test_Back_To_Back(void) {
+	uint64_t start;
+	uint32_t wire_bytes, interrupts, max_cycles;
+	int i;
+
+	num_done = 0;
+	Make_Xfer(0, MMA_ADDR, REG_XHI, 6, 1);
+	Make_Xfer(1, MAG_ADDR, 0x01, 6, 1);
+	Make_Xfer(2, MAG_ADDR, 0x0A, 2, 0);
+	bufs[2][0] = 0x5A;
+	bufs[2][1] = 0xC3;
+	Make_Xfer(3, MMA_ADDR, REG_WHOAMI, 1, 1);
+
+	start = Sim_Now;
+	wire_bytes = Sim_I2C_Stats.Wire_Bytes;
+	interrupts = Sim_I2C_Stats.Interrupts;
+	Sim_I2C_Stats.Max_ISR_Cycles = 0;
+	for (i = 0; i < 4; i++)
+		CHECK(i2c_submit(&xfers[i]), "submit %d refused", i);
+	CHECK(!i2c_submit(&xfers[1]), "transfer still queued submitted again");
+	CHECK(i2c_wait_async(&xfers[3]) == I2C_OK, "last transfer failed");
+	wire_bytes = Sim_I2C_Stats.Wire_Bytes - wire_bytes;
+	interrupts = Sim_I2C_Stats.Interrupts - interrupts;
+
+	for (i = 0; i < 4; i++) {
+		CHECK(xfers[i].Status == I2C_OK, "transfer %d status %d", i, xfers[i].Status);
+		CHECK(done_order[i] == i, "completion %d was transfer %d", i, done_order[i]);
+	}
+	for (i = 0; i < 6; i++) {
+		CHECK(bufs[0][i] == mma.Reg(REG_XHI + i), "MMA byte %d 0x%02X", i, bufs[0][i]);
+		CHECK(bufs[1][i] == mag.Regs[0x01 + i], "magnetometer byte %d 0x%02X", i, bufs[1][i]);
+	}
+	CHECK(mag.Regs[0x0A] == 0x5A && mag.Regs[0x0B] == 0xC3, "magnetometer write lost");
+	CHECK(bufs[3][0] == WHOAMI, "WHO_AM_I 0x%02X", bufs[3][0]);
+
+	// One interrupt per byte plus one STOP detect between transfers: the main
+	// code did nothing but sleep, and the ISR never waited on the bus
+	CHECK(wire_bytes == 9 + 9 + 4 + 4, "%u bytes on the bus", wire_bytes);
+	CHECK(interrupts == wire_bytes + 3, "%u interrupts for %u bytes", interrupts, wire_bytes);
+	max_cycles = Sim_I2C_Stats.Max_ISR_Cycles;
+	CHECK(max_cycles < SCL_Cycles(), "ISR ran %u cycles, an SCL period is %u", max_cycles, SCL_Cycles());
+	// Bytes, plus per transfer a START, a repeated START and the STOP hold
+	CHECK(Sim_Now - start <= (uint64_t) wire_bytes*9*SCL_Cycles() + 4*4*SCL_Cycles(),
+		"queue took %llu cycles for %u bytes", (unsigned long long) (Sim_Now - start), wire_bytes);
+	printf("4 queued transfers: %u bytes in %llu cycles, %u interrupts, longest ISR %u cycles\n",
+		wire_bytes, (unsigned long long) (Sim_Now - start), interrupts, max_cycles);
+}
+
+// A polled read while the queue is busy waits for it to drain
+static void Test_Polled_After_Queue(void) {
+	uint8_t data[4];
+	int status;
+
+	num_done = 0;
+	Make_Xfer(0, MAG_ADDR, 0x00, 6, 1);
+	Make_Xfer(1, MMA_ADDR, REG_CTRL1, 1, 1);
+	i2c_submit(&xfers[0]);
+	i2c_submit(&xfers[1]);
+	status = i2c_read_bytes(MAG_ADDR, 0x04, data, 4);
+	CHECK(status == I2C_OK, "polled read status %d", status);
+	CHECK(num_done == 2 && xfers[0].Status == I2C_OK && xfers[1].Status == I2C_OK,
+		"queue not drained before the polled read: %d done", num_done);
+	CHECK(memcmp(data, &mag.Regs[4], 4) == 0, "polled read data wrong");
+	CHECK(bufs[1][0] == mma.Reg(REG_CTRL1), "queued CTRL1 read 0x%02X", bufs[1][0]);
+}
+
+static void Submit_From_ISR(void) {
+	CHECK(i2c_submit(Make_Xfer(2, MMA_ADDR, REG_WHOAMI, 1, 1)), "submit during polled write refused");
+}
+
+// A transfer submitted while a polled one owns the bus runs after it
+static void Test_Submit_During_Polled(void) {
+	uint8_t data[2] = {0x11, 0x22};
+	int status;
+
+	num_done = 0;
+	mag.On_Start = Submit_From_ISR;
+	status = i2c_write_bytes(MAG_ADDR, 0x05, data, 2);
+	CHECK(status == I2C_OK, "polled write status %d", status);
+	CHECK(mag.On_Start == 0, "hook did not run");
+	CHECK(num_done == 0, "queued transfer ran during the polled write");
+	CHECK(i2c_wait_async(&xfers[2]) == I2C_OK, "queued transfer failed");
+	CHECK(num_done == 1 && bufs[2][0] == WHOAMI, "queued WHO_AM_I read 0x%02X", bufs[2][0]);
+	CHECK(mag.Regs[5] == 0x11 && mag.Regs[6] == 0x22, "polled write lost");
+}
+
+// A polled read nobody answers is retried, and every attempt counts in
+// I2C_Stats.Bytes; a zero-length read is refused without touching the bus
+static void Test_Polled_Retries(void) {
+	uint8_t data[2];
+	uint32_t bytes, retries;
+	int status;
+
+	bytes = I2C_Stats.Bytes;
+	retries = I2C_Stats.Retries;
+	status = i2c_read_bytes(ABSENT_ADDR, 0x00, data, 2);
+	CHECK(status == I2C_ERR_NACK, "read from absent device status %d", status);
+	CHECK(I2C_Stats.Retries - retries == I2C_MAX_RETRIES, "%u retries",
+		I2C_Stats.Retries - retries);
+	CHECK(I2C_Stats.Bytes - bytes == (I2C_MAX_RETRIES + 1)*(3 + 2), "%u bytes counted for %d attempts",
+		I2C_Stats.Bytes - bytes, I2C_MAX_RETRIES + 1);
+
+	bytes = I2C_Stats.Bytes;
+	status = i2c_read_bytes(MMA_ADDR, REG_WHOAMI, data, 0);
+	CHECK(status == I2C_ERR_BAD_ARG, "zero-length read status %d", status);
+	CHECK(I2C_Stats.Bytes == bytes, "zero-length read counted %u bytes", I2C_Stats.Bytes - bytes);
+}
+
+int main(int argc, char * argv[]) {
+	(void) argc;
+	Sim_Reset();
+	Sim_I2C_Attach(&mma);
+	Sim_I2C_Attach(&mag);
+	i2c_init();
+	CHECK(init_mma(), "init_mma failed");
+	mma.Set_Counts(100, -200, 4000);
+	Sim_Idle_us(2500);
+
+	Test_Back_To_Back();
+	Test_Polled_After_Queue();
+	Test_Submit_During_Polled();
+	Test_Polled_Retries();
+	Test_Back_To_Back();
+
+	CHECK(Sim_I2C_Stats.Violations == 0, "%u bus violations (SIM_VERBOSE=1 for details)",
+		Sim_I2C_Stats.Violations);
+	CHECK(Sim_I2C_Stats.Arb_Lost == 0, "%u arbitrations lost", Sim_I2C_Stats.Arb_Lost);
+	CHECK(I2C_Stats.Timeouts == 0, "%u timeouts", I2C_Stats.Timeouts);
+	printf("%s: %d checks, %d failed\n", argv[0], checks, failures);
+	return failures != 0;
+}
@@ -0,0 +1,156 @@
+/*----------------------------------------------------------------------------
+  Host test of the tilt read path: i2c.c, mma8451.c and tilt.c running
+  against the simulated I2C0 and MMA8451 (sim/). For each tilt, checks the
+  LED zone shown, the bytes Process_Tilt reports against the bytes that
+  crossed the bus, and the samples read. Then takes the sensor off the bus
+  and checks the error flash. Built once per configuration by the Makefile.
+
+  Any bus misuse the model catches (Sim_I2C_Stats.Violations), lost
+  arbitration or sensor register write dropped while active fails the test.
+ *----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include "sim.h"
+#include "board.h"
+#include "mma8451_model.h"
+#include "config.h"
+#include "i2c.h"
+#include "mma8451.h"
+#include "tilt.h"
+
+#if USE_MMA_FAST_READ
+#define SAMPLE_BYTES (3)
+#else
+#define SAMPLE_BYTES (6)
+#endif
+#define SETTLE_US (2500)								// two samples at 800 Hz
+#define FIFO_WAKE_US (1000000/LPTMR_SAMPLE_HZ)
+
+static int checks, failures;
+
+#define CHECK(cond, ...) do { \
+	checks++; \
+	if (!(cond)) { \
+		failures++; \
+		printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+		printf(__VA_ARGS__); \
+		printf("\n"); \
+	} \
+} while (0)
+
+typedef struct {
+	double Roll, Pitch;
+	int Zone;
+} TILT_CASE_T;
+
+static const TILT_CASE_T cases[] = {
+	{0, 0, 0}, {10, 0, 0}, {12, 12, 0}, {20, 0, 1}, {0, -22, 1}, {-25, 5, 1},
+	{40, 0, 2}, {10, 35, 2}, {0, -60, 2}, {175, 0, 2}, {-120, 10, 2}
+};
+
+static Sim_MMA8451 mma;
+
+static bool LED_Is(unsigned int red, unsigned int green, unsigned int blue) {
+	return (Sim_LED.Red == red) && (Sim_LED.Green == green) && (Sim_LED.Blue == blue);
+}
+
+static bool LED_Is_Zone(int zone) {
+	return LED_Is(zone >= 1, zone <= 1, 0);
+}
+
+static void Init_Sensor(void) {
+	int ok;
+
+	i2c_init();
+#if USE_MMA_FIFO
+	ok = init_mma_fifo(MMA_FIFO_ODR, MMA_FIFO_WATERMARK);
+#else
+	ok = init_mma();
+#endif
+	CHECK(ok, "sensor init failed");
+#if WAKE_SOURCE == WAKE_ON_MMA_INT
+	CHECK(mma_set_interrupts(MMA_WAKE_EVENTS, MMA_WAKE_EVENTS), "mma_set_interrupts failed");
+	CHECK(mma.Reg(REG_CTRL4) == MMA_WAKE_EVENTS, "CTRL4 0x%02X", mma.Reg(REG_CTRL4));
+#endif
+	CHECK(mma.Reg(REG_CTRL1) & CTRL1_ACTIVE, "sensor left in standby");
+	CHECK(((mma.Reg(REG_CTRL1) & CTRL1_F_READ) != 0) == (USE_MMA_FAST_READ != 0), "F_READ 0x%02X",
+		mma.Reg(REG_CTRL1));
+}
+
+// Hold the tilt for one wake's worth of samples, then process them
+static void Test_Tilt(const TILT_CASE_T * c) {
+	uint32_t wire_bytes, samples_read;
+	int expect_samples, expect_bytes;
+
+	mma.Set_Tilt(c->Roll, c->Pitch);
+#if USE_MMA_FIFO
+	Process_Tilt();												// drain samples of the previous tilt
+	Sim_Idle_us(FIFO_WAKE_US);
+	expect_samples = mma.FIFO_Count();
+	expect_bytes = 4 + 3 + expect_samples*SAMPLE_BYTES;	// F_STATUS read, then the block
+	CHECK((expect_samples >= MMA_FIFO_WATERMARK - 1) && (expect_samples <= MMA_FIFO_WATERMARK + 1),
+		"%d samples in FIFO after one wake", expect_samples);
+#else
+	Sim_Idle_us(SETTLE_US);
+	expect_samples = 1;
+	expect_bytes = 3 + SAMPLE_BYTES;
+#endif
+	Sim_LED.Flashes = 0;
+	wire_bytes = Sim_I2C_Stats.Wire_Bytes;
+	samples_read = mma.Samples_Read;
+	Process_Tilt();
+	wire_bytes = Sim_I2C_Stats.Wire_Bytes - wire_bytes;
+	samples_read = mma.Samples_Read - samples_read;
+
+	CHECK(Sim_LED.Flashes == 1, "roll %g pitch %g: %u flashes", c->Roll, c->Pitch, Sim_LED.Flashes);
+	CHECK(LED_Is_Zone(c->Zone), "roll %g pitch %g: LED %u%u%u, zone %d expected", c->Roll, c->Pitch,
+		Sim_LED.Red, Sim_LED.Green, Sim_LED.Blue, c->Zone);
+	CHECK(Tilt_Samples == expect_samples, "roll %g pitch %g: Tilt_Samples %d, %d expected",
+		c->Roll, c->Pitch, Tilt_Samples, expect_samples);
+	CHECK((int) samples_read == expect_samples, "roll %g pitch %g: sensor gave %u samples",
+		c->Roll, c->Pitch, samples_read);
+	CHECK((int) Tilt_Bus_Bytes == expect_bytes, "roll %g pitch %g: Tilt_Bus_Bytes %u, %d expected",
+		c->Roll, c->Pitch, Tilt_Bus_Bytes, expect_bytes);
+	CHECK((int) wire_bytes == expect_bytes, "roll %g pitch %g: %u bytes on the bus, %d expected",
+		c->Roll, c->Pitch, wire_bytes, expect_bytes);
+}
+
+// Sensor gone: blue flash, no samples, and the next read works again
+static void Test_Absent(void) {
+	uint32_t errors = Tilt_Errors;
+
+	mma.Present = false;
+	Sim_LED.Flashes = 0;
+	Sim_Idle_us(SETTLE_US);
+	Process_Tilt();
+	CHECK(Sim_LED.Flashes == 1 && LED_Is(0, 0, 1), "absent sensor: LED %u%u%u, %u flashes",
+		Sim_LED.Red, Sim_LED.Green, Sim_LED.Blue, Sim_LED.Flashes);
+	CHECK(Tilt_Samples == 0, "absent sensor: Tilt_Samples %d", Tilt_Samples);
+	CHECK(Tilt_Errors == errors + 1, "absent sensor: Tilt_Errors not counted");
+	CHECK(I2C_Stats.Nacks > 0, "absent sensor: no NACK counted");
+
+	mma.Present = true;
+	Test_Tilt(&cases[0]);
+}
+
+int main(int argc, char * argv[]) {
+	unsigned int i;
+
+	(void) argc;
+	Sim_Reset();
+	Sim_I2C_Attach(&mma);
+	Init_Sensor();
+	for (i = 0; i < sizeof(cases)/sizeof(cases[0]); i++)
+		Test_Tilt(&cases[i]);
+	Test_Absent();
+
+	CHECK(Sim_I2C_Stats.Violations == 0, "%u bus violations (SIM_VERBOSE=1 for details)",
+		Sim_I2C_Stats.Violations);
+	CHECK(Sim_I2C_Stats.Arb_Lost == 0, "%u arbitrations lost", Sim_I2C_Stats.Arb_Lost);
+	CHECK(I2C_Stats.Timeouts == 0, "%u timeouts", I2C_Stats.Timeouts);
+	CHECK(mma.Ignored_Writes == 0, "%u sensor writes dropped while active", mma.Ignored_Writes);
+
+	printf("%s: %d checks, %d failed. %u bytes on the bus, %u interrupts (longest %u cycles), %u WFI\n",
+		argv[0], checks, failures, Sim_I2C_Stats.Wire_Bytes, Sim_I2C_Stats.Interrupts,
+		Sim_I2C_Stats.Max_ISR_Cycles, Sim_I2C_Stats.Wfi);
+	return failures != 0;
+}
@@ -0,0 +1,150 @@
+/*----------------------------------------------------------------------------
+  Host accuracy test of the integer roll/pitch pipeline in mma8451.c:
+  isqrt32 exactly, iatan2_cd against atan2, and convert_xyz_to_roll_pitch_cd
+  against a double-precision reference over the whole +-2 g count cube,
+  with the float convert_xyz_to_roll_pitch measured alongside. Fails if
+  any error exceeds the bounds below.
+ *----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include "sim.h"
+#include "mma8451.h"
+
+// Error bounds in centidegrees. iatan2_cd rounds to 1 cd on top of the
+// polynomial error; pitch adds the isqrt32 truncation, which is worst for
+// short vectors near the middle of the cube.
+#define MAX_ATAN2_ERR_CD (1.05)
+#define MAX_ROLL_PITCH_ERR_CD (2.5)
+#define ISQRT_EXHAUSTIVE (1UL << 22)
+#define ISQRT_RANDOM (4000000)
+#define ATAN2_RANGE (32768)						// pitch passes counts << 2
+#define ATAN2_STEP (13)
+#define CUBE_STEP (64)								// grid over the 14-bit count cube
+#define CD_PER_RAD_EXACT (18000/3.14159265358979323846)
+
+static int checks, failures;
+
+#define CHECK(cond, ...) do { \
+	checks++; \
+	if (!(cond)) { \
+		failures++; \
+		printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+		printf(__VA_ARGS__); \
+		printf("\n"); \
+	} \
+} while (0)
+
+typedef struct {
+	double Max, Sum;
+	long N;
+	int32_t At[3];								// inputs of the worst case
+} ERR_T;
+
+static void Add_Err(ERR_T * e, double err, int32_t a, int32_t b, int32_t c) {
+	err = fabs(err);
+	if (err > 18000)								// same angle across the +-180 seam
+		err = 36000 - err;
+	if (err > e->Max) {
+		e->Max = err;
+		e->At[0] = a;
+		e->At[1] = b;
+		e->At[2] = c;
+	}
+	e->Sum += err;
+	e->N++;
+}
+
+static uint32_t xorshift32(void) {
+	static uint32_t x = 2463534242UL;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return x;
+}
+
+static bool Isqrt_Ok(uint32_t n) {
+	uint64_t r = isqrt32(n);
+
+	return (r*r <= n) && ((r + 1)*(r + 1) > n);
+}
+
+static void Test_Isqrt(void) {
+	uint32_t n, bad = 0, k;
+	long i;
+
+	for (n = 0; n < ISQRT_EXHAUSTIVE; n++)
+		bad += !Isqrt_Ok(n);
+	for (i = 0; i < ISQRT_RANDOM; i++)
+		bad += !Isqrt_Ok(xorshift32());
+	for (k = 1; k < 65536; k++)				// either side of every square
+		bad += !Isqrt_Ok(k*k) + !Isqrt_Ok(k*k - 1) + ((k < 65535) ? !Isqrt_Ok(k*k + 1) : 0);
+	bad += !Isqrt_Ok(0xFFFFFFFFUL);
+	CHECK(bad == 0, "isqrt32: %u wrong results", bad);
+	printf("isqrt32: exact over [0, 2^22), %d random values and around every square\n", ISQRT_RANDOM);
+}
+
+static void Test_Atan2(void) {
+	ERR_T e = {0, 0, 0, {0, 0, 0}};
+	int32_t x, y;
+
+	for (y = -ATAN2_RANGE; y <= ATAN2_RANGE; y += ATAN2_STEP)
+		for (x = -ATAN2_RANGE; x <= ATAN2_RANGE; x += ATAN2_STEP)
+			Add_Err(&e, iatan2_cd(y, x) - atan2((double) y, (double) x)*CD_PER_RAD_EXACT, y, x, 0);
+	CHECK(iatan2_cd(0, 0) == 0, "iatan2_cd(0, 0) = %d", iatan2_cd(0, 0));
+	CHECK(iatan2_cd(0, 100) == 0 && iatan2_cd(100, 0) == 9000 && iatan2_cd(0, -100) == 18000 &&
+		iatan2_cd(-100, 0) == -9000, "iatan2_cd axes wrong");
+	CHECK(e.Max <= MAX_ATAN2_ERR_CD, "iatan2_cd: error %.2f cd at y %d x %d", e.Max, e.At[0], e.At[1]);
+	printf("iatan2_cd: max error %.3f cd, mean %.3f cd over %ld points\n", e.Max, e.Sum/e.N, e.N);
+}
+
+// Degrees the float version returns, in centidegrees
+static void Float_Roll_Pitch_cd(int16_t * acc, double * roll, double * pitch) {
+	float r, p;
+
+	convert_xyz_to_roll_pitch(acc, &r, &p);
+	*roll = r*100.0;
+	*pitch = p*100.0;
+}
+
+static void Test_Roll_Pitch(void) {
+	ERR_T roll_err = {0, 0, 0, {0, 0, 0}}, pitch_err = roll_err, froll_err = roll_err, fpitch_err = roll_err;
+	int16_t acc[3], roll_cd, pitch_cd;
+	int32_t x, y, z;
+	double roll, pitch, froll, fpitch;
+
+	for (x = -8192; x <= 8191; x += CUBE_STEP) {
+		for (y = -8192; y <= 8191; y += CUBE_STEP) {
+			for (z = -8192; z <= 8191; z += CUBE_STEP) {
+				acc[0] = x;
+				acc[1] = y;
+				acc[2] = z;
+				roll = atan2((double) y, (double) z)*CD_PER_RAD_EXACT;
+				pitch = atan2((double) x, sqrt((double) y*y + (double) z*z))*CD_PER_RAD_EXACT;
+				convert_xyz_to_roll_pitch_cd(acc, &roll_cd, &pitch_cd);
+				Float_Roll_Pitch_cd(acc, &froll, &fpitch);
+				Add_Err(&roll_err, roll_cd - roll, x, y, z);
+				Add_Err(&pitch_err, pitch_cd - pitch, x, y, z);
+				Add_Err(&froll_err, froll - roll, x, y, z);
+				Add_Err(&fpitch_err, fpitch - pitch, x, y, z);
+			}
+		}
+	}
+	CHECK(roll_err.Max <= MAX_ROLL_PITCH_ERR_CD, "roll_cd: error %.2f cd at %d %d %d",
+		roll_err.Max, roll_err.At[0], roll_err.At[1], roll_err.At[2]);
+	CHECK(pitch_err.Max <= MAX_ROLL_PITCH_ERR_CD, "pitch_cd: error %.2f cd at %d %d %d",
+		pitch_err.Max, pitch_err.At[0], pitch_err.At[1], pitch_err.At[2]);
+	printf("convert_xyz_to_roll_pitch_cd over %ld points: roll max %.3f mean %.3f cd, pitch max %.3f mean %.3f cd\n",
+		roll_err.N, roll_err.Max, roll_err.Sum/roll_err.N, pitch_err.Max, pitch_err.Sum/pitch_err.N);
+	printf("convert_xyz_to_roll_pitch (float) for comparison: roll max %.3f cd, pitch max %.3f cd\n",
+		froll_err.Max, fpitch_err.Max);
+}
+
+int main(int argc, char * argv[]) {
+	(void) argc;
+	Test_Isqrt();
+	Test_Atan2();
+	Test_Roll_Pitch();
+	printf("%s: %d checks, %d failed\n", argv[0], checks, failures);
+	return failures != 0;
+}
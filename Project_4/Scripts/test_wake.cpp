@@ -0,0 +1,100 @@
+/*----------------------------------------------------------------------------
+  Host test of the MMA8451 interrupt wake path in mma_int.c: set-up of the
+  PORTD and LLWU interrupts, the PORTD level interrupt masking itself, and
+  LLWU_IRQHandler clearing the pin wake flag a real LLS or VLLS wake leaves
+  set. The events and energy functions are recorded here instead.
+ *----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include "sim.h"
+#include "config.h"
+#include "mma_int.h"
+#include "events.h"
+#include "energy.h"
+
+static int checks, failures;
+static uint32_t posted, posts;
+
+#define CHECK(cond, ...) do { \
+	checks++; \
+	if (!(cond)) { \
+		failures++; \
+		printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+		printf(__VA_ARGS__); \
+		printf("\n"); \
+	} \
+} while (0)
+
+void Post_Event(uint32_t events) {
+	posted |= events;
+	posts++;
+}
+
+void Record_ISR_Cycles(uint32_t start) {
+	(void) start;
+}
+
+void Energy_Wake_Source(WAKE_SRC_T src) {
+	(void) src;
+}
+
+static uint32_t Pin_IRQC(void) {
+	return MMA_INT_PORT->PCR[MMA_INT_POS] & PORT_PCR_IRQC_MASK;
+}
+
+// Flag left over from the wake that reset us is cleared, both IRQs enabled
+static void Test_Init(void) {
+	Sim_LLWU.F2.Set(MMA_INT_LLWU_F2);
+	Init_MMA_Int();
+	CHECK(!(LLWU->F2 & MMA_INT_LLWU_F2), "WUF14 still set after Init_MMA_Int");
+	CHECK((LLWU->PE4 & MMA_INT_LLWU_PE4) == MMA_INT_LLWU_PE4, "LLWU_P14 not a wake source");
+	CHECK(Sim_IRQ_Enabled(MMA_INT_IRQn), "PORTD IRQ not enabled");
+	CHECK(Sim_IRQ_Enabled(LLWU_IRQn), "LLWU IRQ not enabled");
+	CHECK(Pin_IRQC() == PORT_PCR_IRQC(8), "pin interrupt not armed for logic 0");
+}
+
+// Pin wake from LLS: the LLWU flag is cleared and one sample event results,
+// however many of the two handlers run before the main loop looks
+static void Test_Pin_Wake(void) {
+	Sim_LLWU.F2.Set(MMA_INT_LLWU_F2 | LLWU_F2_WUF15_MASK);
+	posted = posts = 0;
+	LLWU_IRQHandler();
+	CHECK(!(LLWU->F2 & MMA_INT_LLWU_F2), "LLWU_IRQHandler left WUF14 set");
+	CHECK(LLWU->F2 & LLWU_F2_WUF15_MASK, "LLWU_IRQHandler cleared another pin's flag");
+	CHECK(posted == EV_SAMPLE, "LLWU_IRQHandler posted 0x%X", posted);
+	CHECK(Sim_IRQ_Enabled(LLWU_IRQn), "LLWU IRQ disabled after a pin wake");
+	Sim_LLWU.F2 = LLWU_F2_WUF15_MASK;
+
+	PORTD_IRQHandler();
+	CHECK(Pin_IRQC() == 0, "PORTD_IRQHandler left the level interrupt armed");
+	CHECK(posted == EV_SAMPLE, "PORTD_IRQHandler posted 0x%X", posted);
+	Enable_MMA_Int();
+	CHECK(Pin_IRQC() == PORT_PCR_IRQC(8), "Enable_MMA_Int did not re-arm the pin");
+
+	// Nothing to clear: a spurious entry posts nothing
+	posted = 0;
+	LLWU_IRQHandler();
+	CHECK(posted == 0, "LLWU_IRQHandler posted 0x%X with no pin flag", posted);
+}
+
+// LPTMR wake under tickless idle: the module flag only clears in the LPTMR
+// ISR, so the LLWU handler must get out of its way until the next sample
+static void Test_Module_Wake(void) {
+	Sim_LLWU.F3 = LLWU_F3_MWUF0_MASK;
+	posted = 0;
+	LLWU_IRQHandler();
+	CHECK(!Sim_IRQ_Enabled(LLWU_IRQn), "LLWU IRQ still enabled with a module flag set");
+	CHECK(posted == 0, "module wake posted 0x%X", posted);
+	Sim_LLWU.F3 = 0;											// LPTMR ISR clears TCF
+	Enable_MMA_Int();
+	CHECK(Sim_IRQ_Enabled(LLWU_IRQn), "Enable_MMA_Int did not re-enable the LLWU IRQ");
+}
+
+int main(int argc, char * argv[]) {
+	(void) argc;
+	Sim_Reset();
+	Test_Init();
+	Test_Pin_Wake();
+	Test_Module_Wake();
+	printf("%s: %d checks, %d failed\n", argv[0], checks, failures);
+	return failures != 0;
+}
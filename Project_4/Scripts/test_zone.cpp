@@ -0,0 +1,88 @@
+/*----------------------------------------------------------------------------
+  Host test of classify_tilt_zone (tilt.c) against zones from double
+  precision roll and pitch, over the +-2 g count cube: exhaustively over
+  the 8-bit samples of F_READ builds, on a grid plus random points over
+  14-bit ones. A disagreement is only allowed within BOUNDARY_EPS_DEG of a
+  zone limit, where the rounding of the tan^2 constants decides.
+ *----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include "sim.h"
+#include "config.h"
+#include "tilt.h"
+
+#define BOUNDARY_EPS_DEG (0.01)
+#define CUBE_STEP (64)
+#define RANDOM_POINTS (4000000)
+#define DEG_PER_RAD (180/3.14159265358979323846)
+
+static int checks, failures;
+static long points, near_limit, mismatches, allowed;
+
+#define CHECK(cond, ...) do { \
+	checks++; \
+	if (!(cond)) { \
+		failures++; \
+		printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+		printf(__VA_ARGS__); \
+		printf("\n"); \
+	} \
+} while (0)
+
+#if !USE_MMA_FAST_READ
+static uint32_t xorshift32(void) {
+	static uint32_t x = 2463534242UL;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	return x;
+}
+#endif
+
+static void Test_Point(int32_t x, int32_t y, int32_t z) {
+	int16_t acc[3] = {(int16_t) x, (int16_t) y, (int16_t) z};
+	double roll = fabs(atan2((double) y, (double) z))*DEG_PER_RAD;
+	double pitch = fabs(atan2((double) x, sqrt((double) y*y + (double) z*z)))*DEG_PER_RAD;
+	double tilt = roll > pitch ? roll : pitch;
+	int ref = (tilt > TILT_ZONE2_DEG) ? 2 : (tilt > TILT_ZONE1_DEG) ? 1 : 0;
+	int zone = classify_tilt_zone(acc);
+	bool near = (fabs(roll - TILT_ZONE1_DEG) < BOUNDARY_EPS_DEG) || (fabs(roll - TILT_ZONE2_DEG) < BOUNDARY_EPS_DEG) ||
+		(fabs(pitch - TILT_ZONE1_DEG) < BOUNDARY_EPS_DEG) || (fabs(pitch - TILT_ZONE2_DEG) < BOUNDARY_EPS_DEG);
+
+	points++;
+	near_limit += near;
+	if (zone == ref)
+		return;
+	if (near) {
+		allowed++;
+		return;
+	}
+	if (++mismatches <= 10)
+		printf("counts %d %d %d: zone %d, roll %.4f pitch %.4f deg\n", x, y, z, zone, roll, pitch);
+}
+
+int main(int argc, char * argv[]) {
+	int32_t x, y, z;
+
+	(void) argc;
+#if USE_MMA_FAST_READ
+	// every sample F_READ can deliver: 8-bit MSB, scaled by 64
+	for (x = -128; x < 128; x++)
+		for (y = -128; y < 128; y++)
+			for (z = -128; z < 128; z++)
+				Test_Point(x*64, y*64, z*64);
+#else
+	for (x = -8192; x < 8192; x += CUBE_STEP)
+		for (y = -8192; y < 8192; y += CUBE_STEP)
+			for (z = -8192; z < 8192; z += CUBE_STEP)
+				Test_Point(x, y, z);
+	for (long i = 0; i < RANDOM_POINTS; i++)
+		Test_Point((int32_t) (xorshift32() & 0x3FFF) - 8192, (int32_t) (xorshift32() & 0x3FFF) - 8192,
+			(int32_t) (xorshift32() & 0x3FFF) - 8192);
+#endif
+	CHECK(mismatches == 0, "classify_tilt_zone: %ld of %ld points in the wrong zone", mismatches, points);
+	printf("%s: %ld points, %ld within %.2f deg of a limit, %ld of those classified differently\n",
+		argv[0], points, near_limit, BOUNDARY_EPS_DEG, allowed);
+	printf("%s: %d checks, %d failed\n", argv[0], checks, failures);
+	return failures != 0;
+}
@@ -1,10 +1,8 @@
 #include "LPTimer.h"
 #include "MKL25Z4.h"
-#include "LEDs.h"
-#include "GPIO_defs.h"
-#include "Delay.h"
-#include "mma8451.h"
-#include <math.h>
+#include "events.h"
+#include "energy.h"
+#include "config.h"
 volatile int32_t LPT_ticks=0;
 
 void Init_LPTMR(uint32_t freq) {
@@ -15,7 +13,7 @@ void Init_LPTMR(uint32_t freq) {
 	// resulting in 500 Hz clock
 	LPTMR0->PSR = /* LPTMR_PSR_PBYP_MASK | */ LPTMR_PSR_PCS(1) | LPTMR_PSR_PRESCALE(0); 
 	LPTMR0->CSR = LPTMR_CSR_TIE_MASK;
-	LPTMR0->CMR = (FREQ_LPO/(2*freq))-1; // Period - 1
+	LPTMR0->CMR = LPTMR_CMR_FOR_HZ(freq);
 
 #if 1
 	// Configure NVIC 
@@ -25,6 +23,15 @@ void Init_LPTMR(uint32_t freq) {
 #endif
 }
 
+// LPTMR is only reset by POR/LVD, so after a VLLS wake it is still counting
+// with the compare flag that woke us set. Just reconnect it to the NVIC.
+void Resume_LPTMR(void) {
+	SIM->SCGC5 |=  SIM_SCGC5_LPTMR_MASK;
+
+	NVIC_SetPriority(LPTimer_IRQn, 3); 
+	NVIC_EnableIRQ(LPTimer_IRQn);	
+}
+
 void Start_LPTMR(void) {
 	LPTMR0->CSR |= LPTMR_CSR_TEN_MASK;
 }
@@ -33,26 +40,34 @@ void Stop_LPTMR(void) {
 	LPTMR0->CSR &= ~LPTMR_CSR_TEN_MASK;
 }
 
-	int16_t accel[3];
-	float roll, pitch;
+// CMR can only be changed while stopped, which also restarts the period
+void Set_LPTMR_Rate(uint32_t freq) {
+	Stop_LPTMR();
+	LPTMR0->CMR = LPTMR_CMR_FOR_HZ(freq);
+	Start_LPTMR();
+}
+
+// Time until the next compare. CNR must be written to latch the count for reading.
+uint32_t LPTMR_Time_To_Wake_us(void) {
+	uint32_t count;
+	
+	LPTMR0->CNR = 0;
+	count = LPTMR0->CNR;
+	if (count > LPTMR0->CMR)
+		return 0;
+	return (LPTMR0->CMR - count + 1)*(2*1000000/FREQ_LPO);	// prescaler divides by 2
+}
+
 void LPTimer_IRQHandler(void) {
-	SIM->SCGC5 |= SIM_SCGC5_PORTB_MASK;	
+	uint32_t start;
+	
+	ISR_TIMING_START(start)
 	LPTMR0->CSR |= LPTMR_CSR_TCF_MASK;
 
-		LPT_ticks++;
-		read_full_xyz(accel);
-		convert_xyz_to_roll_pitch(accel, &roll, &pitch);
-		
-		if ((fabs(roll) > 30) || (fabs(pitch) > 30))
-		Control_RGB_LEDs(1, 0, 0);
-		else if ((fabs(roll) > 15) || (fabs(pitch) > 15))
-		Control_RGB_LEDs(1, 1, 0);
-		else
-		Control_RGB_LEDs(0, 1, 0);
-      //Delay(1);
-		ShortDelay(50);
-			Control_RGB_LEDs(0, 0, 0);
-
-			//Delay(1);
-			SIM->SCGC5 &= ~SIM_SCGC5_PORTB_MASK; 
-}
\ No newline at end of file
+	LPT_ticks++;
+	ENERGY_WAKE(WAKE_SRC_LPTMR);
+#if !(USE_RTX && USE_TICKLESS_IDLE)		// then it only wakes the RTX idle thread
+	Post_Event(EV_SAMPLE);					// sample is read and processed in main loop
+#endif
+	ISR_TIMING_END(start)
+}
@@ -3,10 +3,14 @@
 #include "MKL25Z4.h"
 
 #define FREQ_LPO (1000)
+#define LPTMR_CMR_FOR_HZ(freq) ((FREQ_LPO/(2*(freq)))-1)	// Period - 1 at LPO/2
 
 void Init_LPTMR(uint32_t freq);
 void Start_LPTMR(void);
 void Stop_LPTMR(void);
+void Resume_LPTMR(void);
+void Set_LPTMR_Rate(uint32_t freq);
+uint32_t LPTMR_Time_To_Wake_us(void);
 
 extern volatile int32_t LPT_ticks;
 
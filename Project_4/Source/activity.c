@@ -0,0 +1,101 @@
+#include "MKL25Z4.h"
+#include "mma8451.h"
+#include "LPTimer.h"
+#include "config.h"
+#include "energy.h"
+#include "activity.h"
+
+// Sensor and MCU rates for each state. Moving matches the start-up config.
+const ACT_RATE_T Activity_Rates[ACT_NUM_STATES] = {
+	{ACT_STILL_ODR, MODS_LP, ACT_STILL_ODR_CHZ, ACT_STILL_LPTMR_HZ},
+	{MMA_FIFO_ODR, MODS_NORMAL, MMA_FIFO_ODR_CHZ, LPTMR_SAMPLE_HZ}
+};
+
+volatile ACT_STATE_T Activity_State = ACT_MOVING;
+ACT_STATS_T Activity_Stats;
+
+static int16_t prev_acc[3];
+static int have_prev = 0;
+static int still_count = 0;
+static uint32_t state_since;		// Energy_Ticks when state time was last charged
+
+// RTC ticks since state_since, in ms
+#define ELAPSED_MS(now) (((now) - state_since)*1000UL/ENERGY_TICK_HZ)
+
+// Cold boot leaves the sensor at the moving rate. After a warm wake it may
+// have been slowed down, so take the state from its ODR.
+void Init_Activity(void) {
+	int i;
+	
+	for (i=0; i<ACT_NUM_STATES; i++) {
+		Activity_Stats.Time_ms[i] = 0;
+		Activity_Stats.Samples[i] = 0;
+		Activity_Stats.Wakes[i] = 0;
+	}
+	Activity_Stats.Transitions = 0;
+	have_prev = 0;
+	still_count = 0;
+	Activity_State = (mma_get_odr() == ACT_STILL_ODR) ? ACT_STILL : ACT_MOVING;
+	state_since = Energy_Ticks();
+}
+
+static void Set_Activity_State(ACT_STATE_T state) {
+	const ACT_RATE_T * r = &Activity_Rates[state];
+	
+	mma_set_rate(r->ODR, r->MODS, (r->ODR_cHz/100)/r->LPTMR_Hz);
+#if WAKE_SOURCE == WAKE_ON_LPTMR
+	Set_LPTMR_Rate(r->LPTMR_Hz);
+#endif
+	Activity_State = state;
+	Activity_Stats.Transitions++;
+}
+
+// Called once per wake with the (averaged) sample and how many sensor samples
+// it covers. Speeds up as soon as acceleration changes by ACT_MOTION_ENTER
+// counts, and only slows down after ACT_STILL_WAKES wakes in a row that moved
+// less than ACT_MOTION_EXIT.
+void Update_Activity(int16_t acc[3], int num_samples) {
+	ACT_STATE_T state = Activity_State;
+	uint32_t change = 0, now = Energy_Ticks();
+	int i;
+	
+	// Time measured on the RTC, not worked out from the samples, so the rate
+	// below is a real measurement of the sensor and wake settings
+	Activity_Stats.Samples[state] += num_samples;
+	Activity_Stats.Time_ms[state] += ELAPSED_MS(now);
+	state_since = now;
+	Activity_Stats.Wakes[state]++;
+
+	if (have_prev) {
+		for (i=0; i<3; i++)
+			change += (acc[i] > prev_acc[i]) ? acc[i] - prev_acc[i] : prev_acc[i] - acc[i];
+	}
+	for (i=0; i<3; i++)
+		prev_acc[i] = acc[i];
+	have_prev = 1;
+	
+	if (change >= ACT_MOTION_ENTER) {
+		still_count = 0;
+		if (state == ACT_STILL)
+			Set_Activity_State(ACT_MOVING);
+	} else if (change < ACT_MOTION_EXIT) {
+		if ((state == ACT_MOVING) && (++still_count >= ACT_STILL_WAKES)) {
+			still_count = 0;
+			Set_Activity_State(ACT_STILL);
+		}
+	}
+}
+
+// Sensor samples processed per second of run time (RTC), x100
+uint32_t Activity_Samples_Per_s_x100(void) {
+	uint32_t samples = 0, ms = ELAPSED_MS(Energy_Ticks());	// not yet charged to a state
+	int i;
+	
+	for (i=0; i<ACT_NUM_STATES; i++) {
+		samples += Activity_Stats.Samples[i];
+		ms += Activity_Stats.Time_ms[i];
+	}
+	if (ms == 0)
+		return 0;
+	return (uint32_t) (((uint64_t) samples*100000)/ms);
+}
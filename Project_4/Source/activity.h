@@ -0,0 +1,29 @@
+#ifndef ACTIVITY_H
+#define ACTIVITY_H
+#include <stdint.h>
+
+typedef enum {ACT_STILL, ACT_MOVING, ACT_NUM_STATES} ACT_STATE_T;
+
+typedef struct {
+	uint8_t ODR;					// MMA8451 CTRL1_DR code
+	uint8_t MODS;					// MMA8451 CTRL2 oversampling mode
+	uint16_t ODR_cHz;			// same ODR in 0.01 Hz, for reporting
+	uint16_t LPTMR_Hz;		// MCU wakes per second
+} ACT_RATE_T;
+
+typedef struct {
+	uint32_t Time_ms[ACT_NUM_STATES];		// time spent in each state, from the RTC
+	uint32_t Samples[ACT_NUM_STATES];		// sensor samples processed in each state
+	uint32_t Wakes[ACT_NUM_STATES];			// MCU wakes (Update_Activity calls) in each state
+	uint32_t Transitions;
+} ACT_STATS_T;
+
+extern const ACT_RATE_T Activity_Rates[ACT_NUM_STATES];
+extern volatile ACT_STATE_T Activity_State;
+extern ACT_STATS_T Activity_Stats;
+
+void Init_Activity(void);
+void Update_Activity(int16_t acc[3], int num_samples);
+uint32_t Activity_Samples_Per_s_x100(void);
+
+#endif
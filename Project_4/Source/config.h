@@ -1,6 +1,175 @@
 #ifndef CONFIG_H
 #define CONFIG_H
 
+// Feature switches can also be set on the compiler command line, as the host
+// builds in Scripts/ do to test several configurations from one tree.
+
+#ifndef USE_SLEEP_MODES
 #define USE_SLEEP_MODES (1)
+#endif
+
+// Target I2C SCL rate. The closest ICR/MULT at or below it is used; with the
+// 800 kHz bus clock of CLOCK_SETUP 2 (4 MHz / OUTDIV4 5) the fastest is 40 kHz
+// (ICR 0, MULT 0), so that is what is asked for. I2C_Speed.SCL_Hz has the rate
+// actually set.
+#define I2C_SCL_HZ (40000)
+
+// Read accelerometer with the interrupt-driven I2C engine, sleeping until done
+#ifndef USE_ASYNC_I2C
+#define USE_ASYNC_I2C (1)
+#endif
+
+// Buffer samples in the MMA8451 FIFO and process them as a block on each wake
+#ifndef USE_MMA_FIFO
+#define USE_MMA_FIFO (1)
+#endif
+#define MMA_FIFO_ODR (ODR_50HZ)
+#define MMA_FIFO_ODR_CHZ (5000)	// MMA_FIFO_ODR in 0.01 Hz
+#define MMA_FIFO_WATERMARK (25) // samples per LPTMR period at 2 Hz
+
+// MCU wakes per second with WAKE_ON_LPTMR
+#define LPTMR_SAMPLE_HZ (2)
+
+// Slow the sensor and LPTMR down while the board is still. Moving uses the
+// MMA_FIFO_ODR / LPTMR_SAMPLE_HZ rates above. Change thresholds are the sum of
+// per-axis differences between successive wakes, in counts (4096/g).
+#ifndef USE_ACTIVITY_CONTROL
+#define USE_ACTIVITY_CONTROL (1)
+#endif
+#define ACT_STILL_ODR (ODR_6_25HZ)
+#define ACT_STILL_ODR_CHZ (625)
+#define ACT_STILL_LPTMR_HZ (1)
+#define ACT_MOTION_ENTER (200)	// about 0.05 g: start moving
+#define ACT_MOTION_EXIT (100)		// below this a wake counts as still
+#define ACT_STILL_WAKES (10)		// still wakes in a row before slowing down
+
+// Classify tilt zone from squared counts instead of computing roll and pitch
+#ifndef USE_TILT_CLASSIFIER
+#define USE_TILT_CLASSIFIER (1)
+#endif
+
+// Set the MMA8451 F_READ bit and read only the 8-bit MSB of each axis: 3 bytes
+// per sample instead of 6. Tilt zones at 30 deg need far less than 1/64 g.
+#ifndef USE_MMA_FAST_READ
+#define USE_MMA_FAST_READ (1)
+#endif
+
+// Time the LED flash with a TPM while the core sleeps instead of spinning
+#ifndef USE_TPM_LED_PULSE
+#define USE_TPM_LED_PULSE (1)
+#endif
+#define TILT_LED_PULSE_US (1000)
+
+// What wakes the MCU to process a sample
+#define WAKE_ON_LPTMR (0)		// poll sensor every LPTMR period
+#define WAKE_ON_MMA_INT (1)	// sleep until MMA8451 INT1 asserts (see mma_int.h for wiring)
+#ifndef WAKE_SOURCE
+#define WAKE_SOURCE (WAKE_ON_LPTMR)
+#endif
+
+// Power manager: deepest stop mode is chosen from the time to the next wake.
+// VLLS3 wakes through reset and re-runs all of main()'s init, so only use it
+// for long gaps. MMA_WAKE_PERIOD_US is the expected time between INT1 wakes.
+// VLLS3 is off by default: LPTMR periods are 1 s at most and FIFO or
+// data-ready INT1 wakes come every MMA_WAKE_PERIOD_US, all below
+// PWR_VLLS3_MIN_US. It can be reached with WAKE_ON_MMA_INT and
+// USE_MMA_TILT_ENGINE (USE_ACTIVITY_CONTROL 0), which wake only when the
+// tilt changes; only then do the VLLS3 row and the warm wake path in main.c
+// run. A check below rejects PWR_ALLOW_VLLS3 where no sleep is long enough.
+#ifndef PWR_ALLOW_VLLS3
+#define PWR_ALLOW_VLLS3 (0)
+#endif
+#define PWR_LLS_MIN_US (1000)
+#define PWR_VLLS3_MIN_US (2000000)
+#define MMA_WAKE_PERIOD_US (500000)
+#define MMA_TILT_WAKE_PERIOD_US (10000000)	// expected time between tilt changes
+#define PWR_DEBUG_PINS (0)	// DEBUG3 high while asleep, for measuring wake latency
+
+// Track time awake and in each stop mode, and wake counts by source. Average
+// current is estimated from these supply currents (nA at 3 V, 25 C: stop
+// modes from the KL25 datasheet, run and wait scaled to the 4 MHz BLPI clock
+// of CLOCK_SETUP 2). Replace with measured values.
+#ifndef USE_ENERGY_STATS
+#define USE_ENERGY_STATS (1)
+#endif
+#define PWR_RUN_NA (1100000)
+#define PWR_WAIT_NA (600000)
+#define PWR_VLPS_NA (4400)
+#define PWR_LLS_NA (2000)
+#define PWR_VLLS3_NA (1500)
+
+// Let the MMA8451 motion engines detect tilt zone changes (no angle math on
+// the MCU). Needs WAKE_SOURCE == WAKE_ON_MMA_INT.
+#ifndef USE_MMA_TILT_ENGINE
+#define USE_MMA_TILT_ENGINE (0)
+#endif
+#define TILT_ENGINE_ODR (ODR_12_5HZ)
+
+// Run sampling, processing and LED output as RTX threads linked by mail queues
+// instead of the single main loop. Needs the CMSIS RTOS Keil RTX component
+// (RTE/CMSIS/RTX_Conf_CM.c) enabled in the project. Mail pools are fixed size:
+// each sample mail holds a full FIFO block.
+#ifndef USE_RTX
+#define USE_RTX (0)
+#endif
+#define PIPE_SAMPLE_MAILS (2)
+#define PIPE_ZONE_MAILS (2)
+
+// Stop the RTX tick while all threads are blocked and sleep until the next
+// timeout on the LPTMR. The LPTMR cannot also be the sample clock.
+#ifndef USE_TICKLESS_IDLE
+#define USE_TICKLESS_IDLE (1)
+#endif
+
+#if USE_RTX && USE_TICKLESS_IDLE && (WAKE_SOURCE != WAKE_ON_MMA_INT)
+#error USE_TICKLESS_IDLE uses the LPTMR as the RTX wake timer: needs WAKE_SOURCE == WAKE_ON_MMA_INT
+#endif
+
+// Per-thread CPU share and stack high-water marks, refreshed every
+// THREAD_STATS_PERIOD_MS in Thread_Stats (thread_stats.h)
+#ifndef USE_THREAD_STATS
+#define USE_THREAD_STATS (1)
+#endif
+#define THREAD_STATS_PERIOD_MS (1000)
+
+#if USE_RTX && (USE_MMA_TILT_ENGINE || !USE_ASYNC_I2C)
+#error USE_RTX needs USE_ASYNC_I2C and reads samples, so not USE_MMA_TILT_ENGINE
+#endif
+
+#if USE_ACTIVITY_CONTROL && (!USE_MMA_FIFO || USE_MMA_TILT_ENGINE)
+#error USE_ACTIVITY_CONTROL works on FIFO blocks: needs USE_MMA_FIFO without USE_MMA_TILT_ENGINE
+#endif
+
+#if USE_ACTIVITY_CONTROL && !USE_ENERGY_STATS
+#error USE_ACTIVITY_CONTROL times each state on the RTC that USE_ENERGY_STATS starts
+#endif
+
+#if USE_MMA_TILT_ENGINE && (WAKE_SOURCE != WAKE_ON_MMA_INT)
+#error USE_MMA_TILT_ENGINE requires WAKE_SOURCE == WAKE_ON_MMA_INT
+#endif
+
+// Longest sleep the power manager can be asked for
+#if USE_MMA_TILT_ENGINE
+#define PWR_LONGEST_SLEEP_US (MMA_TILT_WAKE_PERIOD_US)
+#elif WAKE_SOURCE == WAKE_ON_MMA_INT
+#define PWR_LONGEST_SLEEP_US (MMA_WAKE_PERIOD_US)
+#elif USE_ACTIVITY_CONTROL
+#define PWR_LONGEST_SLEEP_US (1000000/ACT_STILL_LPTMR_HZ)
+#else
+#define PWR_LONGEST_SLEEP_US (1000000/LPTMR_SAMPLE_HZ)
+#endif
+
+#if PWR_ALLOW_VLLS3 && (PWR_LONGEST_SLEEP_US < PWR_VLLS3_MIN_US)
+#error PWR_ALLOW_VLLS3 would never be used: no sleep is as long as PWR_VLLS3_MIN_US with these settings
+#endif
+
+// MMA8451 events that assert INT1 when WAKE_SOURCE is WAKE_ON_MMA_INT
+#if USE_MMA_TILT_ENGINE
+#define MMA_WAKE_EVENTS (INT_EN_FF_MT | INT_EN_TRANS)
+#elif USE_MMA_FIFO
+#define MMA_WAKE_EVENTS (INT_EN_FIFO)
+#else
+#define MMA_WAKE_EVENTS (INT_EN_DRDY)
+#endif
 
 #endif
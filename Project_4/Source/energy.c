@@ -0,0 +1,97 @@
+#include "MKL25Z4.h"
+#include "config.h"
+#include "power.h"
+#include "energy.h"
+
+ENERGY_STATS_T Energy_Stats;
+static volatile int asleep = 0;
+
+// Supply current in each mode, from config.h
+static const uint32_t mode_current_nA[PWR_NUM_MODES] = {
+	PWR_WAIT_NA, PWR_VLPS_NA, PWR_LLS_NA, PWR_VLLS3_NA
+};
+
+void Init_Energy(void) {
+	int i;
+	
+	// RTC counts the LPO. It keeps running through VLLS resets, so only set it
+	// up when its time is invalid (after power-on).
+	SIM->SCGC6 |= SIM_SCGC6_RTC_MASK;
+	if (RTC->SR & RTC_SR_TIF_MASK) {
+		SIM->SOPT1 = (SIM->SOPT1 & ~SIM_SOPT1_OSC32KSEL_MASK) | SIM_SOPT1_OSC32KSEL(3);
+		RTC->SR = 0;
+		RTC->TSR = 0;						// clears TIF
+		RTC->SR = RTC_SR_TCE_MASK;
+	}
+
+	for (i=0; i<PWR_NUM_MODES; i++) {
+		Energy_Stats.Sleep_Ticks[i] = 0;
+		Energy_Stats.Sleeps[i] = 0;
+	}
+	for (i=0; i<WAKE_SRC_NUM; i++)
+		Energy_Stats.Wakes[i] = 0;
+	Energy_Stats.Start = Energy_Ticks();
+	Energy_Stats.Last_Sleep = Energy_Stats.Last_Wake = Energy_Stats.Start;
+}
+
+// TSR counts every 32768 ticks (TPR bit 14 going from 1 to 0), and TPR's low 15
+// bits the ticks in between. TPR bit 15 just toggles with TSR, so mask it off.
+// Re-read if TSR changed under us.
+uint32_t Energy_Ticks(void) {
+	uint32_t tsr, tpr;
+	
+	do {
+		tsr = RTC->TSR;
+		tpr = RTC->TPR;
+	} while (tsr != RTC->TSR);
+	return (tsr << 15) + (tpr & 0x7FFF);
+}
+
+// Called with interrupts masked just before __wfi
+void Energy_Sleep_Begin(void) {
+	if (asleep)								// nobody claimed the last wake
+		Energy_Stats.Wakes[WAKE_SRC_OTHER]++;
+	Energy_Stats.Last_Sleep = Energy_Ticks();
+	asleep = 1;
+}
+
+// Called just after __wfi, before the waking ISR runs
+void Energy_Sleep_End(void) {
+	PWR_MODE_T mode = Power_Get_Mode();
+	
+	Energy_Stats.Last_Wake = Energy_Ticks();
+	Energy_Stats.Sleep_Ticks[mode] += Energy_Stats.Last_Wake - Energy_Stats.Last_Sleep;
+	Energy_Stats.Sleeps[mode]++;
+}
+
+// Called by ISRs that can wake us; the first one after a sleep gets the credit.
+// Sleeps that nobody claims are counted when the next one starts.
+void Energy_Wake_Source(WAKE_SRC_T src) {
+	if (asleep) {
+		asleep = 0;
+		Energy_Stats.Wakes[src]++;
+	}
+}
+
+uint32_t Energy_Active_Ticks(void) {
+	uint32_t asleep_ticks = 0;
+	int i;
+	
+	for (i=0; i<PWR_NUM_MODES; i++)
+		asleep_ticks += Energy_Stats.Sleep_Ticks[i];
+	return (Energy_Ticks() - Energy_Stats.Start) - asleep_ticks;
+}
+
+// Time-weighted supply current since Init_Energy, from the per-mode figures
+uint32_t Energy_Average_nA(void) {
+	uint32_t total = Energy_Ticks() - Energy_Stats.Start;
+	uint64_t charge;
+	int i;
+	
+	if (total == 0)
+		return PWR_RUN_NA;
+	charge = (uint64_t) Energy_Active_Ticks() * PWR_RUN_NA;
+	for (i=0; i<PWR_NUM_MODES; i++)
+		charge += (uint64_t) Energy_Stats.Sleep_Ticks[i] * mode_current_nA[i];
+	return (uint32_t) (charge/total);
+}
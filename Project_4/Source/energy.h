@@ -0,0 +1,37 @@
+#ifndef ENERGY_H
+#define ENERGY_H
+#include <stdint.h>
+#include "config.h"
+#include "power.h"
+
+// Timestamps are RTC ticks: the RTC prescaler counts the 1 kHz LPO, which
+// runs in every mode we use and is not reset by VLLS wakes
+#define ENERGY_TICK_HZ (1000)
+
+typedef enum {WAKE_SRC_LPTMR, WAKE_SRC_LLWU_PIN, WAKE_SRC_TPM, WAKE_SRC_OTHER, WAKE_SRC_NUM} WAKE_SRC_T;
+
+typedef struct {
+	uint32_t Start;											// tick count at Init_Energy
+	uint32_t Last_Sleep, Last_Wake;			// tick count at latest transitions
+	uint32_t Sleep_Ticks[PWR_NUM_MODES];	// time asleep in each mode
+	uint32_t Sleeps[PWR_NUM_MODES];
+	uint32_t Wakes[WAKE_SRC_NUM];				// by first ISR to run after waking
+} ENERGY_STATS_T;
+
+extern ENERGY_STATS_T Energy_Stats;
+
+void Init_Energy(void);
+uint32_t Energy_Ticks(void);
+void Energy_Sleep_Begin(void);
+void Energy_Sleep_End(void);
+void Energy_Wake_Source(WAKE_SRC_T src);
+uint32_t Energy_Active_Ticks(void);
+uint32_t Energy_Average_nA(void);
+
+#if USE_ENERGY_STATS
+#define ENERGY_WAKE(src) Energy_Wake_Source(src)
+#else
+#define ENERGY_WAKE(src)
+#endif
+
+#endif
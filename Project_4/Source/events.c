@@ -0,0 +1,131 @@
+#include "MKL25Z4.h"
+#include "GPIO_defs.h"
+#include "config.h"
+#include "events.h"
+#include "energy.h"
+#include "thread_stats.h"
+#if USE_RTX
+#include "cmsis_os.h"
+#endif
+
+static volatile uint32_t pending_events = 0;
+static volatile uint32_t cycle_wraps = 0;
+volatile uint32_t ISR_Max_Cycles = 0;		// longest ISR measured, in core clock cycles
+#if USE_RTX
+static osThreadId event_thread = 0;
+#endif
+
+#if USE_RTX
+// RTX owns SysTick (OS_TICK period) and keeps its own 32-bit cycle count
+void Start_Cycle_Counter(void) {
+}
+
+uint32_t Get_Cycles(void) {
+	return osKernelSysTick();
+}
+#else
+
+// SysTick as a free-running 24-bit down counter of core clock cycles. Its
+// interrupt only counts wraps so Get_Cycles can time long spans such as boot.
+// Does not count while in deep sleep.
+void Start_Cycle_Counter(void) {
+	cycle_wraps = 0;
+	SysTick->LOAD = SysTick_LOAD_RELOAD_Msk;
+	SysTick->VAL = 0;
+	NVIC_SetPriority(SysTick_IRQn, 3); 
+	SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_TICKINT_Msk | SysTick_CTRL_ENABLE_Msk;
+}
+
+void SysTick_Handler(void) {
+	cycle_wraps++;
+}
+
+// Core clock cycles since Start_Cycle_Counter
+uint32_t Get_Cycles(void) {
+	uint32_t primask = __get_PRIMASK();
+	uint32_t wraps, val;
+	
+	__disable_irq();
+	wraps = cycle_wraps;
+	val = SysTick->VAL;
+	if (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) {	// wrapped, handler not run yet
+		wraps++;
+		val = SysTick->VAL;
+	}
+	__set_PRIMASK(primask);
+	return wraps*(SysTick_LOAD_RELOAD_Msk + 1) + (SysTick_LOAD_RELOAD_Msk - val);
+}
+#endif
+
+// With RTX, events are signals to the thread that calls Init_Events
+void Init_Events(void) {
+	pending_events = 0;
+	ISR_Max_Cycles = 0;
+#if USE_RTX
+	event_thread = osThreadGetId();
+#endif
+}
+
+// Called from ISRs: just record the event, the main loop does the work
+void Post_Event(uint32_t events) {
+#if USE_RTX
+	if (event_thread)
+		osSignalSet(event_thread, events);
+#else
+	uint32_t primask = __get_PRIMASK();
+	
+	__disable_irq();
+	pending_events |= events;
+	__set_PRIMASK(primask);
+#endif
+}
+
+// Sleep until at least one event is pending, then return and clear all of them.
+// Interrupts are masked while checking so an event posted just before __wfi
+// still wakes us: WFI returns on a pending interrupt even with PRIMASK set.
+#if USE_RTX
+uint32_t Wait_For_Events(void) {
+	osEvent evt;
+	
+	THREAD_BLOCK();
+	evt = osSignalWait(0, osWaitForever);
+	THREAD_WAKE();
+	return evt.value.signals & EV_ALL;
+}
+#else
+uint32_t Wait_For_Events(void) {
+	uint32_t events;
+	
+	__disable_irq();
+	while (pending_events == 0) {
+#if USE_ENERGY_STATS
+		Energy_Sleep_Begin();
+#endif
+#if PWR_DEBUG_PINS
+		SET_BIT(DEBUG3_POS);
+		__wfi();
+		CLEAR_BIT(DEBUG3_POS);
+#else
+		__wfi();
+#endif
+#if USE_ENERGY_STATS
+		Energy_Sleep_End();
+#endif
+		__enable_irq();								// let the waking ISR run
+		__disable_irq();
+	}
+	events = pending_events;
+	pending_events = 0;
+	__enable_irq();
+	return events;
+}
+#endif
+
+// Allows for one SysTick reload during the ISR, whatever the reload value
+void Record_ISR_Cycles(uint32_t start) {
+	uint32_t val = SysTick->VAL;
+	uint32_t cycles = (start >= val) ? start - val : start + SysTick->LOAD + 1 - val;
+	
+	if (cycles > ISR_Max_Cycles)
+		ISR_Max_Cycles = cycles;
+}
@@ -0,0 +1,25 @@
+#ifndef EVENTS_H
+#define EVENTS_H
+#include <stdint.h>
+
+// Events posted by ISRs for the main loop
+#define EV_SAMPLE (1UL << 0)		// time to read and process the accelerometer
+#define EV_LED_DONE (1UL << 1)	// LED pulse finished, deeper sleep allowed again
+#define EV_ALL (EV_SAMPLE | EV_LED_DONE)
+
+void Init_Events(void);
+void Post_Event(uint32_t events);
+uint32_t Wait_For_Events(void);
+
+// Cycle counting with SysTick as a free-running core clock counter
+void Start_Cycle_Counter(void);
+uint32_t Get_Cycles(void);
+
+// ISR duration measurement
+#define ISR_TIMING_START(start) {start = SysTick->VAL;}
+#define ISR_TIMING_END(start) {Record_ISR_Cycles(start);}
+void Record_ISR_Cycles(uint32_t start);
+
+extern volatile uint32_t ISR_Max_Cycles;
+
+#endif
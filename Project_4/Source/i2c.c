@@ -1,6 +1,84 @@
 #include	 <MKL25Z4.H>
 #include	 "i2c.h"
 #include 	"gpio_defs.h"
+#include	 "config.h"
+#include	 "events.h"
+#include	 "Delay.h"
+#include	 "thread_stats.h"
+#if USE_RTX
+#include	 "cmsis_os.h"
+#endif
+
+I2C_STATS_T I2C_Stats;
+I2C_SPEED_T I2C_Speed;
+static uint32_t i_byte_timeout;						// core clock cycles allowed per byte
+
+// KL25Z I2C divider and hold values for each ICR, in bus clocks (before MULT)
+static const uint16_t scl_div[64] = {
+	20, 22, 24, 26, 28, 30, 34, 40, 28, 32, 36, 40, 44, 48, 56, 68,
+	48, 56, 64, 72, 80, 88, 104, 128, 80, 96, 112, 128, 144, 160, 192, 240,
+	160, 192, 224, 256, 288, 320, 384, 480, 320, 384, 448, 512, 576, 640, 768, 960,
+	640, 768, 896, 1024, 1152, 1280, 1536, 1920, 1280, 1536, 1792, 2048, 2304, 2560, 3072, 3840
+};
+static const uint16_t sda_hold[64] = {
+	7, 7, 8, 8, 9, 9, 10, 10, 7, 7, 9, 9, 11, 11, 13, 13,
+	9, 9, 13, 13, 17, 17, 21, 21, 9, 9, 17, 17, 25, 25, 33, 33,
+	17, 17, 33, 33, 49, 49, 65, 65, 33, 33, 65, 65, 97, 97, 129, 129,
+	65, 65, 129, 129, 193, 193, 257, 257, 129, 129, 257, 257, 385, 385, 513, 513
+};
+static const uint16_t start_hold[64] = {
+	6, 7, 8, 9, 10, 11, 13, 16, 10, 12, 14, 16, 18, 20, 24, 30,
+	18, 22, 26, 30, 34, 38, 46, 58, 38, 46, 54, 62, 70, 78, 94, 118,
+	78, 94, 110, 126, 142, 158, 190, 238, 158, 190, 222, 254, 286, 318, 382, 478,
+	318, 382, 446, 510, 574, 638, 766, 958, 638, 766, 894, 1022, 1150, 1278, 1534, 1918
+};
+static const uint16_t stop_hold[64] = {
+	11, 12, 13, 14, 15, 16, 18, 21, 15, 17, 19, 21, 23, 25, 29, 35,
+	25, 29, 33, 37, 41, 45, 53, 65, 41, 49, 57, 65, 73, 81, 97, 121,
+	81, 97, 113, 129, 145, 161, 193, 241, 161, 193, 225, 257, 289, 321, 385, 481,
+	321, 385, 449, 513, 577, 641, 769, 961, 641, 769, 897, 1025, 1153, 1281, 1537, 1921
+};
+
+static uint32_t bus_clocks_to_ns(uint32_t clocks, uint32_t bus_hz) {
+	return (uint32_t) (((uint64_t) clocks * 1000000000UL)/bus_hz);
+}
+
+// I2C runs from the bus clock: core clock / (OUTDIV4+1)
+uint32_t i2c_bus_clock(void) {
+	return SystemCoreClock/(((SIM->CLKDIV1 & SIM_CLKDIV1_OUTDIV4_MASK) >> SIM_CLKDIV1_OUTDIV4_SHIFT) + 1);
+}
+
+// Pick the fastest ICR/MULT that does not exceed scl_hz (SCL = bus/(mul*div)),
+// or the slowest setting if the bus clock is too fast for the target. Returns
+// the achieved SCL frequency; hold times are in I2C_Speed.
+uint32_t i2c_set_speed(uint32_t scl_hz, uint32_t bus_hz) {
+	uint32_t rate, best_rate = 0;
+	uint8_t icr, mult, best_icr = 0x3F, best_mult = 2;
+	
+	for (mult = 0; mult < 3; mult++) {
+		for (icr = 0; icr < 64; icr++) {
+			rate = bus_hz/((1UL << mult)*scl_div[icr]);
+			if ((rate <= scl_hz) && (rate > best_rate)) {
+				best_rate = rate;
+				best_icr = icr;
+				best_mult = mult;
+			}
+		}
+	}
+	if (best_rate == 0)
+		best_rate = bus_hz/((1UL << best_mult)*scl_div[best_icr]);
+	
+	I2C0->F = I2C_F_ICR(best_icr) | I2C_F_MULT(best_mult);
+	
+	I2C_Speed.SCL_Hz = best_rate;
+	I2C_Speed.SDA_Hold_ns = bus_clocks_to_ns(sda_hold[best_icr] << best_mult, bus_hz);
+	I2C_Speed.Start_Hold_ns = bus_clocks_to_ns(start_hold[best_icr] << best_mult, bus_hz);
+	I2C_Speed.Stop_Hold_ns = bus_clocks_to_ns(stop_hold[best_icr] << best_mult, bus_hz);
+	I2C_Speed.ICR = best_icr;
+	I2C_Speed.MULT = best_mult;
+	i_byte_timeout = I2C_TIMEOUT_MARGIN*9*(SystemCoreClock/best_rate);
+	return best_rate;
+}
 
 
 //init i2c0
@@ -17,8 +95,8 @@ void i2c_init( void )
 	PORTE->PCR[ 25 ] |= PORT_PCR_MUX( 5 );
 
 	//set baud rate
-	//baud = bus freq/(scl_div+mul)
-	I2C0->F				= ( I2C_F_ICR( 0x11 ) | I2C_F_MULT( 0 ) ); // 0x11
+	//baud = bus freq/(scl_div*mul)
+	i2c_set_speed(I2C_SCL_HZ, i2c_bus_clock());
 
 	//enable i2c and set to master mode
 	I2C0->C1		 |= ( I2C_C1_IICEN_MASK );
@@ -26,60 +104,100 @@ void i2c_init( void )
 	// Select high drive mode
 	I2C0->C2		 |= ( I2C_C2_HDRS_MASK );
 	
-	// Enable interrupt with NVIC
-	// NVIC_EnableIRQ(I2C0_IRQn);
+	// Enable interrupt with NVIC. Must preempt LPTimer_IRQHandler, which may wait
+	// for an async transaction.
+	NVIC_SetPriority(I2C0_IRQn, I2C_IRQ_PRIORITY);
+	NVIC_ClearPendingIRQ(I2C0_IRQn);
+	NVIC_EnableIRQ(I2C0_IRQn);
 }
 
 
-void i2c_busy(void){
-
-	// Start Signal
-	I2C0->C1 &= ~I2C_C1_IICEN_MASK;
-	I2C_TRAN;
-	I2C_M_START;
-	I2C0->C1 |=  I2C_C1_IICEN_MASK;
-	// Write to clear line
-	I2C0->C1 |= I2C_C1_MST_MASK; /* set MASTER mode */  
-	I2C0->C1 |= I2C_C1_TX_MASK; /* Set transmit (TX) mode */  
-	I2C0->D = 0xFF;
-	while ((I2C0->S & I2C_S_IICIF_MASK) == 0U) {
-	} /* wait interrupt */  
-	I2C0->S |= I2C_S_IICIF_MASK; /* clear interrupt bit */  
-		
-	/* Clear arbitration error flag*/  
-	I2C0->S |= I2C_S_ARBL_MASK;
-		
-	/* Send start */  
-	I2C0->C1 &= ~I2C_C1_IICEN_MASK;
-	I2C0->C1 |= I2C_C1_TX_MASK; /* Set transmit (TX) mode */  
-	I2C0->C1 |= I2C_C1_MST_MASK; /* START signal generated */  
-		
-	I2C0->C1 |= I2C_C1_IICEN_MASK;
-	/*Wait until start is send*/  
-
-	/* Send stop */  
+// Release a bus that a slave is holding: a device reset or interrupted in the
+// middle of a read keeps SDA low until it has clocked out its byte. Bit-bang
+// up to 9 SCL clocks until SDA is released, then a STOP. Pins are driven
+// open-drain style: output low, or input and let the pull-up raise the line.
+void i2c_recover_bus(void) {
+	int i;
+	
+	I2C_Stats.Recoveries++;
 	I2C0->C1 &= ~I2C_C1_IICEN_MASK;
-	I2C0->C1 |= I2C_C1_MST_MASK;
-	I2C0->C1 &= ~I2C_C1_MST_MASK; /* set SLAVE mode */  
-	I2C0->C1 &= ~I2C_C1_TX_MASK; /* Set Rx */  
-	I2C0->C1 |= I2C_C1_IICEN_MASK;
+	PTE->PCOR = MASK(I2C_SCL_POS) | MASK(I2C_SDA_POS);
+	PTE->PDDR &= ~(MASK(I2C_SCL_POS) | MASK(I2C_SDA_POS));
+	PORTE->PCR[I2C_SCL_POS] = PORT_PCR_MUX(1);
+	PORTE->PCR[I2C_SDA_POS] = PORT_PCR_MUX(1);
 	
-	/* wait */  
-	/* Clear arbitration error & interrupt flag*/  
-	I2C0->S |= I2C_S_IICIF_MASK;
-	I2C0->S |= I2C_S_ARBL_MASK;
+	for (i=0; (i<9) && !(PTE->PDIR & MASK(I2C_SDA_POS)); i++) {
+		PTE->PDDR |= MASK(I2C_SCL_POS);				// SCL low
+		ShortDelay(I2C_BITBANG_DELAY);
+		PTE->PDDR &= ~MASK(I2C_SCL_POS);			// SCL high
+		ShortDelay(I2C_BITBANG_DELAY);
+	}
+	// STOP: SDA rises while SCL is high
+	PTE->PDDR |= MASK(I2C_SCL_POS);
+	ShortDelay(I2C_BITBANG_DELAY);
+	PTE->PDDR |= MASK(I2C_SDA_POS);
+	ShortDelay(I2C_BITBANG_DELAY);
+	PTE->PDDR &= ~MASK(I2C_SCL_POS);
+	ShortDelay(I2C_BITBANG_DELAY);
+	PTE->PDDR &= ~MASK(I2C_SDA_POS);
+	ShortDelay(I2C_BITBANG_DELAY);
+
+	PORTE->PCR[I2C_SCL_POS] = PORT_PCR_MUX(I2C_PIN_MUX);
+	PORTE->PCR[I2C_SDA_POS] = PORT_PCR_MUX(I2C_PIN_MUX);
+	I2C0->C1 &= ~(I2C_C1_MST_MASK | I2C_C1_TX_MASK | I2C_C1_TXAK_MASK);
+	I2C0->S = I2C_S_IICIF_MASK | I2C_S_ARBL_MASK;
+	I2C0->C1 |= I2C_C1_IICEN_MASK;
 }
 
-void i2c_wait(void) {
-	int lock_detect = 200;
+// Wait for the byte in progress, bounded by the SysTick cycle counter.
+// Returns I2C_OK, I2C_ERR_TIMEOUT, I2C_ERR_ARB_LOST, or I2C_ERR_NACK if
+// check_ack is set and the byte we sent was not acknowledged.
+int i2c_wait(int check_ack) {
+	uint32_t start = Get_Cycles();
+	uint8_t status;
 	
-	while(((I2C0->S & I2C_S_IICIF_MASK)==0) & (lock_detect > 0)) {
-		lock_detect--;
+	while (((status = I2C0->S) & I2C_S_IICIF_MASK) == 0) {
+		if (Get_Cycles() - start > i_byte_timeout)
+			return I2C_ERR_TIMEOUT;
 	} 
-	if (lock_detect <= 0)
-		i2c_busy();
-	
   I2C0->S |= I2C_S_IICIF_MASK;
+	if (status & I2C_S_ARBL_MASK)
+		return I2C_ERR_ARB_LOST;
+	if (check_ack && (status & I2C_S_RXAK_MASK))
+		return I2C_ERR_NACK;
+	return I2C_OK;
+}
+
+// A START needs the bus idle: wait out the STOP hold time of the last
+// transaction, bounded like a byte
+static int i2c_wait_idle(void) {
+	uint32_t start = Get_Cycles();
+	
+	while (I2C0->S & I2C_S_BUSY_MASK) {
+		if (Get_Cycles() - start > i_byte_timeout)
+			return I2C_ERR_TIMEOUT;
+	}
+	return I2C_OK;
+}
+
+static void i2c_count_error(int status) {
+	if (status == I2C_ERR_NACK)
+		I2C_Stats.Nacks++;
+	else if (status == I2C_ERR_ARB_LOST)
+		I2C_Stats.Arb_Lost++;
+	else if (status == I2C_ERR_TIMEOUT)
+		I2C_Stats.Timeouts++;
+}
+
+// Give up on a polled transaction: release the bus and pass the status on
+static int i2c_abort(int status) {
+	i2c_count_error(status);
+	I2C0->S |= I2C_S_ARBL_MASK;
+	NACK;
+	I2C_M_STOP;
+	I2C_TRAN;
+	CLEAR_BIT(DEBUG2_POS);
+	return status;
 }
 
 #if 0 // Version 2: ISR signals i2c_read_bytes to continue in each i2c_wait_nb call
@@ -137,142 +255,414 @@ int i2c_read_bytes(uint8_t dev_adx, uint8_t reg_adx, uint8_t * data, uint8_t dat
 
 #endif
 
-#if 0 // state machine in ISR
-// Variables for ISR to use for current transaction
-uint8_t i_dev_adx;
-uint8_t i_reg_adx;
-uint8_t * i_data;
-uint8_t i_data_count;
-uint8_t i_num_bytes_read;
+// Interrupt-driven transaction engine. Transactions from any client queue up
+// in submission order; the ISR advances the one at the head one bus event per
+// interrupt, calls its completion callback and sends STOP. The STOP detect
+// interrupt (FLT[STOPF]) then starts the next one, so queued transfers run
+// back to back without the main code and without the ISR waiting on the bus.
+// Polled transactions claim the bus: they wait for the queue to drain, and
+// transactions submitted meanwhile start when they release it.
+static I2C_XFER_T * volatile i_xfer = 0;	// transaction in progress (queue head), 0 if idle
+static I2C_XFER_T * i_tail = 0;						// last queued transaction
+static uint8_t i_state;
+static uint8_t i_count;										// bytes transferred so far
+static uint32_t i_started;								// Get_Cycles when head was started, or STOP sent
+static volatile uint8_t i_stopping = 0;		// waiting for STOPF before starting the head
+static volatile uint8_t i_polled = 0;			// a polled transaction owns the bus
+
+enum {ST_DEV_ADX_W, ST_REG_ADX, ST_WRITE_DATA, ST_DEV_ADX_R, ST_READ_DATA};
+
+static void i2c_start(I2C_XFER_T * xfer) {
+	SET_BIT(DEBUG2_POS);
+	i_state = ST_DEV_ADX_W;
+	i_count = 0;
+	i_started = Get_Cycles();
+	I2C0->S |= I2C_S_IICIF_MASK | I2C_S_ARBL_MASK;
+	I2C0->C1 |= I2C_C1_IICIE_MASK; 		// Enable I2C interrupts
+	ACK;
+	I2C_TRAN;													//	set to transmit mode							
+	I2C_M_START;											//	send start										
+	I2C0->D = xfer->Dev_Adx;					//	send dev address (write)							
+	CLEAR_BIT(DEBUG2_POS);
+}
+
+// The last STOP is done, or there is none to wait for: start the queue head.
+// STOPF must be cleared before IICIF.
+static void i2c_stopped(void) {
+	I2C0->FLT = (I2C0->FLT & ~I2C_FLT_STOPIE_MASK) | I2C_FLT_STOPF_MASK;
+	I2C0->S |= I2C_S_IICIF_MASK;
+	i_stopping = 0;
+	if (i_xfer && !i_polled)
+		i2c_start(i_xfer);
+	else
+		I2C0->C1 &= ~I2C_C1_IICIE_MASK; 	// Disable I2C interrupts
+}
+
+// START needs the bus idle: start the queue head from the STOP detect
+// interrupt once the STOP just sent is done, or now if the bus is already free
+static void i2c_start_after_stop(void) {
+	i_stopping = 1;
+	i_started = Get_Cycles();
+	I2C0->FLT |= I2C_FLT_STOPF_MASK | I2C_FLT_STOPIE_MASK;	// clear an old STOPF, interrupt on ours
+	I2C0->C1 |= I2C_C1_IICIE_MASK;
+	if (!(I2C0->S & I2C_S_BUSY_MASK))
+		i2c_stopped();
+}
+
+// Complete the head transaction and line up the next queued one, if any
+static void i2c_finish(int8_t status) {
+	I2C_XFER_T * xfer = i_xfer;
+	
+	if (status != I2C_OK) {
+		i2c_count_error(status);
+		I2C0->S |= I2C_S_ARBL_MASK;			// clear arbitration lost flag
+		NACK;
+	}
+	I2C_M_STOP;												//	send stop										
+	i_stopping = 1;										// a callback's submit must not START yet
+	i_xfer = xfer->Next;
+	if (!i_xfer)
+		i_tail = 0;
+	xfer->Status = status;
+	if (xfer->Callback)
+		xfer->Callback(xfer);
+#if USE_RTX
+	if (xfer->Waiter)
+		osSignalSet((osThreadId) xfer->Waiter, I2C_RTX_SIGNAL);
+#endif
+	
+	if (i_xfer && !i_polled) {
+		i2c_start_after_stop();
+	} else {
+		i_stopping = 0;									// next submit waits out the STOP itself
+		I2C0->C1 &= ~I2C_C1_IICIE_MASK; // Disable I2C interrupts
+	}
+}
+
+// Call with interrupts masked. Whichever transaction is at the head may be
+// the one that hung, or its STOP detect never came.
+static void i2c_check_timeout(void) {
+	I2C_XFER_T * head = i_xfer;
+	
+	if (!head || i_polled)
+		return;
+	if (i_stopping) {
+		if (Get_Cycles() - i_started > i_byte_timeout)
+			i2c_stopped();
+	} else if (Get_Cycles() - i_started > (head->Count + 3)*i_byte_timeout) {
+		i2c_recover_bus();
+		i2c_finish(I2C_ERR_TIMEOUT);		// and start the next one
+	}
+}
 
-// State machine version of ISR to reduce OS overhead
 void I2C0_IRQHandler(void) {
-	static int next_state=0;
-	uint8_t dummy;
+	I2C_XFER_T * xfer = i_xfer;
+	uint8_t status, dummy;
 	
 	SET_BIT(DEBUG1_POS);
+	status = I2C0->S;
+	if (!(status & I2C_S_IICIF_MASK)) {	// still pending from a flag already handled
+		CLEAR_BIT(DEBUG1_POS);
+		return;
+	}
+	if (i_stopping) {
+		if (I2C0->FLT & I2C_FLT_STOPF_MASK)
+			i2c_stopped();
+		else
+			I2C0->S |= I2C_S_IICIF_MASK;
+		CLEAR_BIT(DEBUG1_POS);
+		return;
+	}
   I2C0->S |= I2C_S_IICIF_MASK; // Clear flag
+	if (!xfer) {
+		I2C0->C1 &= ~I2C_C1_IICIE_MASK; // spurious: nothing in progress
+		CLEAR_BIT(DEBUG1_POS);
+		return;
+	}
+	if (status & I2C_S_ARBL_MASK) {
+		i2c_finish(I2C_ERR_ARB_LOST);
+		CLEAR_BIT(DEBUG1_POS);
+		return;
+	}
+	if ((i_state != ST_READ_DATA) && (status & I2C_S_RXAK_MASK)) {
+		i2c_finish(I2C_ERR_NACK);				// no acknowledge for address or data
+		CLEAR_BIT(DEBUG1_POS);
+		return;
+	}
 
-	switch (next_state) {
-		case 0:
-			I2C0->D = i_reg_adx;								//	send register address								
-			next_state = 1;
+	switch (i_state) {
+		case ST_DEV_ADX_W:
+			I2C0->D = xfer->Reg_Adx;					//	send register address								
+			i_state = ST_REG_ADX;
 			break;
-		case 1:
-			I2C_M_RSTART;											//	repeated start									
-			I2C0->D = i_dev_adx | 0x01 ;				//	send dev address (read)							
-			next_state = 2;
+		case ST_REG_ADX:
+			if (xfer->Read) {
+				I2C_M_RSTART;										//	repeated start									
+				I2C0->D = xfer->Dev_Adx | 0x01;	//	send dev address (read)							
+				i_state = ST_DEV_ADX_R;
+				break;
+			}
+			i_state = ST_WRITE_DATA;
+			// fall through - send the first data byte
+		case ST_WRITE_DATA:
+			if (i_count < xfer->Count)
+				I2C0->D = xfer->Data[i_count++];	//	write data										
+			else
+				i2c_finish(I2C_OK);
 			break;
-		case 2:
+		case ST_DEV_ADX_R:
 			I2C_REC;													//	set to receive mode								
-			ACK;										
+			if (xfer->Count == 1)
+				NACK;														//	only byte: no ack
+			else
+				ACK;										
 			dummy = I2C0->D;								//	dummy read to start Rx of first byte										
-			next_state = 3;
+			(void) dummy;
+			i_state = ST_READ_DATA;
 			break;
-		case 3:
-			if (i_num_bytes_read == i_data_count-2) { // last read
-				NACK;
-				i_data[i_num_bytes_read++] = I2C0->D; //	read data										
-				next_state = 4;
+		case ST_READ_DATA:
+			if (i_count == xfer->Count-1) {	// last byte: stop before reading D so no further byte is clocked in
+				I2C_M_STOP;
+				xfer->Data[i_count++] = I2C0->D;
+				i2c_finish(I2C_OK);
 			} else {
-				ACK;
-				i_data[i_num_bytes_read++] = I2C0->D; //	read data										
-				if (i_num_bytes_read < i_data_count-1) {
-					next_state = 3;
-				} else { 
-					next_state = 4;
-				}
+				if (i_count == xfer->Count-2)
+					NACK;													//	next byte is the last one
+				else
+					ACK;
+				xfer->Data[i_count++] = I2C0->D; //	read data										
 			}
 			break;
-		case 4:
-			I2C_M_STOP;												//	send stop										
-			I2C0->C1 &= ~I2C_C1_IICIE_MASK; 	// Disable I2C interrupts
-			next_state = 0;
-			break;
 		default:
-			next_state = 0;
+			i2c_finish(I2C_ERR_NACK);
 			break;
 	}
 	CLEAR_BIT(DEBUG1_POS);
 }
 
-int i2c_read_bytes(uint8_t dev_adx, uint8_t reg_adx, uint8_t * data, uint8_t data_count) {
-	// Load up ISR's copy of relevant variables
-	static int n_idle;
+// Queue a transaction, starting it at once if the bus is idle. Returns 0 if
+// xfer is invalid or still queued from an earlier submit.
+int i2c_submit(I2C_XFER_T * xfer) {
+	uint32_t primask;
 	
-	SET_BIT(DEBUG2_POS);
-	idle_counter = 0;
-	i_dev_adx = dev_adx;
-	i_reg_adx = reg_adx;
-	i_data = data;
-	i_data_count = data_count;
-	i_num_bytes_read=0;
-	I2C0->C1 |= I2C_C1_IICIE_MASK; 		// Enable I2C interrupts
-	I2C_TRAN;													//	set to transmit mode							
-	I2C_M_START;											//	send start										
-	I2C0->D = dev_adx;								//	send dev address (write)							
+	if ((xfer->Count == 0 && xfer->Read) || (xfer->Status == I2C_BUSY))
+		return 0;
 	
-	n_idle = idle_counter;
-	CLEAR_BIT(DEBUG2_POS);
+	I2C_Stats.Transactions++;
+	I2C_Stats.Bytes += (xfer->Read ? 3 : 2) + xfer->Count;
+	xfer->Status = I2C_BUSY;
+	xfer->Next = 0;
+	xfer->Waiter = 0;
+	
+	primask = __get_PRIMASK();
+	__disable_irq();
+	if (i_xfer) {
+		i_tail->Next = xfer;
+		i_tail = xfer;
+	} else {
+		i_xfer = i_tail = xfer;
+		if (!i_stopping && !i_polled) {	// else started when the STOP is done or the bus released
+			i2c_wait_idle();							// a polled transaction's STOP may still be on the bus
+			i2c_start(xfer);
+		}
+	}
+	__set_PRIMASK(primask);
 	return 1;
 }
+
+int i2c_busy_async(void) {
+	return i_xfer != 0;
+}
+
+#if USE_RTX
+// Block the calling thread until xfer completes so other threads can run.
+// i2c_finish signals the waiter; the timeout is checked at least every
+// I2C_RTX_POLL_MS in case the bus hung and no interrupt comes.
+int8_t i2c_wait_async(I2C_XFER_T * xfer) {
+	xfer->Waiter = osThreadGetId();		// if it already finished, Status says so
+	while (xfer->Status == I2C_BUSY) {
+		THREAD_BLOCK();
+		osSignalWait(I2C_RTX_SIGNAL, I2C_RTX_POLL_MS);
+		THREAD_WAKE();
+		__disable_irq();
+		i2c_check_timeout();
+		__enable_irq();
+	}
+	xfer->Waiter = 0;
+	return xfer->Status;
+}
+#else
+// Sleep (not deep sleep, which would stop the I2C clock) until xfer completes,
+// which may be after the transactions queued ahead of it. The timeout is only
+// checked when something wakes us, so a hung bus is noticed at the latest on
+// the next SysTick wrap.
+int8_t i2c_wait_async(I2C_XFER_T * xfer) {
+	uint32_t scr = SCB->SCR;
+	
+	SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+	__disable_irq();									// so completion can't slip in before __wfi
+	while (xfer->Status == I2C_BUSY) {
+		__wfi();												// wakes on pending interrupt even with PRIMASK set
+		__enable_irq();
+		__disable_irq();
+		i2c_check_timeout();
+	}
+	__enable_irq();
+	SCB->SCR = scr;
+	return xfer->Status;
+}
+#endif
+
+// Polled transactions share the bus with the queue: wait until it has
+// drained, sleeping as i2c_wait_async does, then hold back queued
+// transactions until i2c_release
+static void i2c_claim(void) {
+#if !USE_RTX
+	uint32_t scr = SCB->SCR;
+	
+	SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+#endif
+	__disable_irq();
+	while (i_xfer || i_stopping) {
+#if USE_RTX
+		__enable_irq();
+		THREAD_BLOCK();
+		osDelay(1);
+		THREAD_WAKE();
+		__disable_irq();
+#else
+		__wfi();
+		__enable_irq();
+		__disable_irq();
+#endif
+		i2c_check_timeout();
+	}
+	i_polled = 1;
+	__enable_irq();
+#if !USE_RTX
+	SCB->SCR = scr;
 #endif
+}
 
+// Start whatever was submitted while the polled transaction had the bus
+static void i2c_release(void) {
+	__disable_irq();
+	i_polled = 0;
+	if (i_xfer)
+		i2c_start_after_stop();
+	__enable_irq();
+}
 
-int i2c_read_bytes(uint8_t dev_adx, uint8_t reg_adx, uint8_t * data, uint8_t data_count) {
+static int i2c_read_once(uint8_t dev_adx, uint8_t reg_adx, uint8_t * data, uint8_t data_count) {
 	uint8_t dummy, num_bytes_read=0;
+	int status;
 	
+	I2C_Stats.Bytes += 3 + data_count;
+	if ((status = i2c_wait_idle()) != I2C_OK)
+		return i2c_abort(status);
 	I2C_TRAN;													//	set to transmit mode							
 	SET_BIT(DEBUG2_POS);
 	I2C_M_START;											//	send start										
 	I2C0->D = dev_adx;								//	send dev address (write)							
-	i2c_wait();												//	wait for completion								
+	if ((status = i2c_wait(1)) != I2C_OK)	//	wait for completion								
+		return i2c_abort(status);
 
 	I2C0->D = reg_adx;								//	send register address								
-	i2c_wait();												//	wait for completion								
+	if ((status = i2c_wait(1)) != I2C_OK)
+		return i2c_abort(status);
 
 	I2C_M_RSTART;											//	repeated start									
 	I2C0->D = dev_adx | 0x01 ;				//	send dev address (read)							
-	i2c_wait();												//	wait for completion								
+	if ((status = i2c_wait(1)) != I2C_OK)
+		return i2c_abort(status);
 
 	I2C_REC;													//	set to receive mode								
 
-	ACK;										
+	if (data_count == 1)
+		NACK;														//	only byte: no ack
+	else
+		ACK;										
 	dummy = I2C0->D;								//	dummy read to start Rx of first byte										
+	(void) dummy;
 
 	do {
-		i2c_wait();											//	wait for completion								
-		if (num_bytes_read == data_count-2) { // last read
-			NACK;
+		if ((status = i2c_wait(0)) != I2C_OK)	//	wait for completion								
+			return i2c_abort(status);
+		if (num_bytes_read == data_count-1) { // last byte received
+			I2C_M_STOP;										//	send stop before reading so no extra byte is clocked in
 			data[num_bytes_read++] = I2C0->D; //	read data										
-			i2c_wait();												//	wait for completion				
-			I2C_M_STOP;										//	send stop										
 		} else {
-			ACK;
+			if (num_bytes_read == data_count-2) // next byte is the last one
+				NACK;
 			data[num_bytes_read++] = I2C0->D; //	read data										
 		}
 	} while (num_bytes_read < data_count);
 
 	CLEAR_BIT(DEBUG2_POS);
-	return 1;
+	return I2C_OK;
 }
 
-int i2c_write_bytes(uint8_t dev_adx, uint8_t reg_adx, uint8_t * data, uint8_t data_count) {
+static int i2c_write_once(uint8_t dev_adx, uint8_t reg_adx, uint8_t * data, uint8_t data_count) {
 	uint8_t num_bytes_written=0;
+	int status;
 	
+	I2C_Stats.Bytes += 2 + data_count;
+	if ((status = i2c_wait_idle()) != I2C_OK)
+		return i2c_abort(status);
 	I2C_TRAN;													//	set to transmit mode							
 	I2C_M_START;											//	send start										
 	I2C0->D = dev_adx;								//	send dev address (write)							
-	i2c_wait();												//	wait for completion								
+	if ((status = i2c_wait(1)) != I2C_OK)	//	wait for completion								
+		return i2c_abort(status);
 
 	I2C0->D = reg_adx;								//	send register address								
-	i2c_wait();												//	wait for completion								
+	if ((status = i2c_wait(1)) != I2C_OK)
+		return i2c_abort(status);
 
 	while (num_bytes_written < data_count) {
 		I2C0->D = data[num_bytes_written++]; //	write data										
-		i2c_wait();											//	wait for completion								
+		if ((status = i2c_wait(1)) != I2C_OK)
+			return i2c_abort(status);
 	}
 	I2C_M_STOP;												//		send stop										
 	
-	return 1;
+	return I2C_OK;
+}
+
+// Bus is stuck or taken unless the device simply did not answer
+static void i2c_before_retry(int status) {
+	I2C_Stats.Retries++;
+	if (status != I2C_ERR_NACK)
+		i2c_recover_bus();
+}
+
+// Polled read with retries, after any queued transactions. Returns I2C_OK,
+// the last error, or I2C_ERR_BAD_ARG for a zero-length read, which
+// i2c_read_once can't do: the NACK goes with the last byte received.
+int i2c_read_bytes(uint8_t dev_adx, uint8_t reg_adx, uint8_t * data, uint8_t data_count) {
+	int status, tries = 0;
+	
+	if (data_count == 0)
+		return I2C_ERR_BAD_ARG;
+	I2C_Stats.Transactions++;
+	i2c_claim();
+	while (((status = i2c_read_once(dev_adx, reg_adx, data, data_count)) != I2C_OK) &&
+		(tries++ < I2C_MAX_RETRIES))
+		i2c_before_retry(status);
+	i2c_release();
+	return status;
+}
+
+// Polled write with retries, after any queued transactions. Returns I2C_OK or
+// the last error.
+int i2c_write_bytes(uint8_t dev_adx, uint8_t reg_adx, uint8_t * data, uint8_t data_count) {
+	int status, tries = 0;
+	
+	I2C_Stats.Transactions++;
+	i2c_claim();
+	while (((status = i2c_write_once(dev_adx, reg_adx, data, data_count)) != I2C_OK) &&
+		(tries++ < I2C_MAX_RETRIES))
+		i2c_before_retry(status);
+	i2c_release();
+	return status;
 }
@@ -16,9 +16,87 @@
 #define NACK 	        I2C0->C1 |= I2C_C1_TXAK_MASK
 #define ACK           I2C0->C1 &= ~I2C_C1_TXAK_MASK
 
+#define I2C_IRQ_PRIORITY (2)
+
+// I2C0 pins on port E, for bus recovery
+#define I2C_SCL_POS (24)
+#define I2C_SDA_POS (25)
+#define I2C_PIN_MUX (5)
+
+// Transaction status, returned by i2c_read_bytes/i2c_write_bytes and in I2C_XFER_T
+#define I2C_OK (0)
+#define I2C_BUSY (1)
+#define I2C_ERR_NACK (-1)
+#define I2C_ERR_ARB_LOST (-2)
+#define I2C_ERR_TIMEOUT (-3)
+#define I2C_ERR_BAD_ARG (-4)			// nothing to read: data_count 0
+
+// A byte that takes more than I2C_TIMEOUT_MARGIN byte times (9 SCL periods at
+// the rate set by i2c_set_speed) times out. Failed transactions are retried
+// up to I2C_MAX_RETRIES times, with a bus recovery first unless the device
+// just NACKed. Worst case for an n-byte polled transaction is therefore
+//   (I2C_MAX_RETRIES+1) * n * I2C_TIMEOUT_MARGIN byte times + I2C_MAX_RETRIES recoveries
+// where n includes the 2 or 3 address/register bytes, and a recovery is at
+// most 10 bit-banged SCL clocks.
+#define I2C_TIMEOUT_MARGIN (4)
+#define I2C_MAX_RETRIES (2)
+#define I2C_BITBANG_DELAY (2)			// ShortDelay count per SCL half period
+
+// Achieved bus speed from i2c_set_speed
+typedef struct {
+	uint32_t SCL_Hz;
+	uint32_t SDA_Hold_ns;						// SCL falling to SDA change
+	uint32_t Start_Hold_ns;					// SDA falling to SCL falling for START
+	uint32_t Stop_Hold_ns;					// SCL rising to SDA rising for STOP
+	uint8_t ICR, MULT;
+} I2C_SPEED_T;
+
+extern I2C_SPEED_T I2C_Speed;
+
+// Bus traffic, including address and register bytes and every retried
+// attempt, and errors by class
+typedef struct {
+	uint32_t Transactions;
+	uint32_t Bytes;
+	uint32_t Nacks;
+	uint32_t Arb_Lost;
+	uint32_t Timeouts;
+	uint32_t Retries;
+	uint32_t Recoveries;
+} I2C_STATS_T;
+
+extern I2C_STATS_T I2C_Stats;
+
+typedef struct I2C_XFER_S I2C_XFER_T;
+typedef void (* I2C_CALLBACK_T)(I2C_XFER_T * xfer);
+
+struct I2C_XFER_S {
+	uint8_t Dev_Adx;
+	uint8_t Reg_Adx;
+	uint8_t * Data;
+	uint8_t Count;
+	uint8_t Read;										// 1 to read Count bytes, 0 to write them
+	volatile int8_t Status;					// I2C_BUSY until complete; must not be I2C_BUSY when submitted
+	I2C_CALLBACK_T Callback;				// called from I2C0_IRQHandler on completion, may be 0
+	I2C_XFER_T * Next;							// queue link, owned by the driver while I2C_BUSY
+	void * Waiter;									// RTX thread blocked in i2c_wait_async, signalled on completion
+};
+
+// With RTX, i2c_wait_async blocks on this thread signal and checks for a hung
+// bus every I2C_RTX_POLL_MS
+#define I2C_RTX_SIGNAL (1UL << 15)
+#define I2C_RTX_POLL_MS (10)
+
 void i2c_init(void);
+uint32_t i2c_bus_clock(void);
+uint32_t i2c_set_speed(uint32_t scl_hz, uint32_t bus_hz);
 int i2c_read_bytes(uint8_t dev_adx, uint8_t reg_adx, uint8_t * data, uint8_t data_count);
 int i2c_write_bytes(uint8_t dev_adx, uint8_t reg_adx, uint8_t * data, uint8_t data_count);
-void i2c_wait( void );
+int i2c_wait(int check_ack);
+void i2c_recover_bus(void);
+
+int i2c_submit(I2C_XFER_T * xfer);
+int i2c_busy_async(void);
+int8_t i2c_wait_async(I2C_XFER_T * xfer);
 
 #endif // I2C_H
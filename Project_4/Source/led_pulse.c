@@ -0,0 +1,95 @@
+#include "MKL25Z4.h"
+#include "LEDs.h"
+#include "led_pulse.h"
+#include "events.h"
+#include "energy.h"
+
+void Init_LED_Pulse(void) {
+	SIM->SCGC6 |= SIM_SCGC6_TPM0_MASK | SIM_SCGC6_TPM2_MASK;
+	
+	// MCGIRCLK clocks the TPMs. CLOCK_SETUP 2 (BLPI) already runs the core from
+	// the 4 MHz fast IRC, so leave IRCS alone and keep it on in stop mode.
+	MCG->C1 |= MCG_C1_IRCLKEN_MASK | MCG_C1_IREFSTEN_MASK;
+	SIM->SOPT2 = (SIM->SOPT2 & ~SIM_SOPT2_TPMSRC_MASK) | SIM_SOPT2_TPMSRC(3);
+
+	// Stop counter after one overflow, keep counting in debug halt
+	TPM0->SC = 0;
+	TPM2->SC = 0;
+	TPM0->CONF = TPM_CONF_CSOO_MASK | TPM_CONF_DBGMODE(3);
+	TPM2->CONF = TPM_CONF_CSOO_MASK | TPM_CONF_DBGMODE(3);
+	
+	NVIC_SetPriority(TPM0_IRQn, 3); 
+	NVIC_ClearPendingIRQ(TPM0_IRQn); 
+	NVIC_EnableIRQ(TPM0_IRQn);	
+	NVIC_SetPriority(TPM2_IRQn, 3); 
+	NVIC_ClearPendingIRQ(TPM2_IRQn); 
+	NVIC_EnableIRQ(TPM2_IRQn);	
+}
+
+// Edge-aligned high-true PWM: output is high (LED off) from reload until CnV,
+// low (LED on) from CnV until MOD, then high again at the overflow that stops
+// the counter. One period is the whole pulse.
+static void Start_Pulse_TPM(TPM_Type * tpm, uint32_t ticks) {
+	tpm->SC = 0;
+	tpm->CNT = 0;
+	tpm->MOD = ticks + 1;
+	tpm->SC = TPM_SC_TOF_MASK | TPM_SC_TOIE_MASK | TPM_SC_CMOD(1) | TPM_SC_PS(LED_TPM_PRESCALE);
+}
+
+static void Set_Pulse_Channel(TPM_Type * tpm, int ch) {
+	tpm->CONTROLS[ch].CnSC = TPM_CnSC_MSB_MASK | TPM_CnSC_ELSB_MASK;
+	tpm->CONTROLS[ch].CnV = 1;
+}
+
+// Light the selected LEDs for us microseconds without keeping the CPU awake.
+// Returns immediately; the TPM overflow interrupt hands the pins back to GPIO.
+void LED_Pulse(unsigned int red_on, unsigned int green_on, unsigned int blue_on, uint32_t us) {
+	uint32_t ticks;
+	
+	if (us > LED_PULSE_MAX_US)
+		us = LED_PULSE_MAX_US;
+	ticks = us/(1000000/LED_TPM_CLOCK_HZ);
+	if (ticks == 0)
+		ticks = 1;
+	
+	SIM->SCGC5 |= SIM_SCGC5_PORTB_MASK | SIM_SCGC5_PORTD_MASK;
+	if (red_on) {
+		Set_Pulse_Channel(RED_LED_TPM, RED_LED_CH);
+		PORTB->PCR[RED_LED_POS] = PORT_PCR_MUX(LED_TPM_MUX_RG);
+	}
+	if (green_on) {
+		Set_Pulse_Channel(GREEN_LED_TPM, GREEN_LED_CH);
+		PORTB->PCR[GREEN_LED_POS] = PORT_PCR_MUX(LED_TPM_MUX_RG);
+	}
+	if (blue_on) {
+		Set_Pulse_Channel(BLUE_LED_TPM, BLUE_LED_CH);
+		PORTD->PCR[BLUE_LED_POS] = PORT_PCR_MUX(LED_TPM_MUX_B);
+	}
+	if (red_on || green_on)
+		Start_Pulse_TPM(TPM2, ticks);
+	if (blue_on)
+		Start_Pulse_TPM(TPM0, ticks);
+}
+
+// TOIE stays set from start of pulse until the overflow ISR has run
+int LED_Pulse_Active(void) {
+	return ((TPM0->SC | TPM2->SC) & TPM_SC_TOIE_MASK) != 0;
+}
+
+void TPM0_IRQHandler(void) {
+	TPM0->SC = TPM_SC_TOF_MASK;			// stop counter, clear flag
+	ENERGY_WAKE(WAKE_SRC_TPM);
+	TPM0->CONTROLS[BLUE_LED_CH].CnSC = 0;
+	PORTD->PCR[BLUE_LED_POS] = PORT_PCR_MUX(1);		// back to GPIO, driven high (off)
+	Post_Event(EV_LED_DONE);
+}
+
+void TPM2_IRQHandler(void) {
+	TPM2->SC = TPM_SC_TOF_MASK;
+	ENERGY_WAKE(WAKE_SRC_TPM);
+	TPM2->CONTROLS[RED_LED_CH].CnSC = 0;
+	TPM2->CONTROLS[GREEN_LED_CH].CnSC = 0;
+	PORTB->PCR[RED_LED_POS] = PORT_PCR_MUX(1);
+	PORTB->PCR[GREEN_LED_POS] = PORT_PCR_MUX(1);
+	Post_Event(EV_LED_DONE);
+}
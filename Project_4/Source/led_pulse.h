@@ -0,0 +1,25 @@
+#ifndef LED_PULSE_H
+#define LED_PULSE_H
+#include <stdint.h>
+
+// Freedom KL25Z RGB LED pins as TPM channels
+#define RED_LED_TPM TPM2
+#define RED_LED_CH (0)				// PTB18, ALT3
+#define GREEN_LED_TPM TPM2
+#define GREEN_LED_CH (1)			// PTB19, ALT3
+#define BLUE_LED_TPM TPM0
+#define BLUE_LED_CH (1)				// PTD1, ALT4
+#define LED_TPM_MUX_RG (3)
+#define LED_TPM_MUX_B (4)
+
+// TPMs count the 4 MHz fast IRC (MCGIRCLK) divided by 128, which keeps running
+// in VLPS (but not LLS/VLLS), so a pulse times itself while the core sleeps
+#define LED_TPM_PRESCALE (7)
+#define LED_TPM_CLOCK_HZ (4000000UL >> LED_TPM_PRESCALE)	// 31.25 kHz, 32 us/tick
+#define LED_PULSE_MAX_US (2000000UL)	// 16-bit MOD
+
+void Init_LED_Pulse(void);
+void LED_Pulse(unsigned int red_on, unsigned int green_on, unsigned int blue_on, uint32_t us);
+int LED_Pulse_Active(void);
+
+#endif
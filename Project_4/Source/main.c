@@ -12,47 +12,160 @@
 #include "mma8451.h"
 #include "LPTimer.h"
 #include "Delay.h"
+#include "config.h"
+#include "mma_int.h"
+#include "events.h"
+#include "tilt.h"
+#include "led_pulse.h"
+#include "power.h"
+#include "activity.h"
+#include "energy.h"
+#include "pipeline.h"
+#include "tickless.h"
+#include "thread_stats.h"
+#if USE_RTX
+#include "cmsis_os.h"
+#endif
 
 void Init_Accel(void) {
 	Delay(50);
+#if USE_MMA_TILT_ENGINE
+	if (!mma_init_tilt_engines(TILT_ENGINE_ODR)) {			/* init mma motion engines, sets interrupts */
+#elif USE_MMA_FIFO
+	if (!init_mma_fifo(MMA_FIFO_ODR, MMA_FIFO_WATERMARK)) {		/* init mma peripheral with FIFO */
+#else
 	if (!init_mma()) {												/* init mma peripheral */
+#endif
 		Control_RGB_LEDs(1, 0, 0);							/* light red error LED */
 		while (1)																/* not able to initialize mma */
 			;
 	}
+#if (WAKE_SOURCE == WAKE_ON_MMA_INT) && !USE_MMA_TILT_ENGINE
+	if (!mma_set_interrupts(MMA_WAKE_EVENTS, MMA_WAKE_EVENTS)) { // all on INT1
+		Control_RGB_LEDs(1, 0, 0);							/* light red error LED */
+		while (1)																/* no wake source */
+			;
+	}
+#endif
 	Delay(50);
 }
 
-void Tilt( void ) {
+static uint32_t Time_To_Next_Wake_us(void) {
+#if WAKE_SOURCE == WAKE_ON_LPTMR
+	return LPTMR_Time_To_Wake_us();
+#elif USE_MMA_TILT_ENGINE
+	return MMA_TILT_WAKE_PERIOD_US;
+#else
+	return MMA_WAKE_PERIOD_US;
+#endif
+}
 
+// Things that must survive the coming sleep
+static uint32_t Sleep_Needs(void) {
+	uint32_t needs = 0;
 	
-	// Start LPTimer for future use
-	Init_LPTMR(2);
-	Start_LPTMR();
+#if !PWR_ALLOW_VLLS3
+	needs |= PWR_NEED_REGISTERS;
+#endif
+#if USE_TPM_LED_PULSE
+	if (LED_Pulse_Active())
+		needs |= PWR_NEED_MCGIRCLK;		// TPMs have no clock in LLS or VLLS
+#endif
+	return needs;
+}
+
+// Reset to first processed sample, for comparing cold and warm boots
+volatile int Warm_Boot = 0;
+volatile uint32_t Boot_Latency_Cycles = 0;
+
+// VLLS wake goes through reset, but the MMA8451 (own supply) and the LPTMR
+// (only reset by POR) carry on. Skip their set-up when they still are.
+static int Is_Warm_Wake(void) {
+	if (!(RCM->SRS0 & RCM_SRS0_WAKEUP_MASK))
+		return 0;
+	return mma_is_active();
+}
+
+// Start whatever posts EV_SAMPLE. Events go to the calling thread under RTX.
+void Init_Sampling(void) {
+	Init_Events();
+#if USE_ENERGY_STATS
+	Init_Energy();
+#endif
+#if USE_ACTIVITY_CONTROL
+	Init_Activity();
+#endif
+#if USE_TPM_LED_PULSE
+	Init_LED_Pulse();
+#endif
+#if WAKE_SOURCE == WAKE_ON_MMA_INT
+	// Sleep until the accelerometer has data for us
+	Init_MMA_Int();
+#else
+	if (Warm_Boot) {
+		Resume_LPTMR();				// pending compare flag gives the first sample
+	} else {
+		// Start LPTimer for future use
+		Init_LPTMR(LPTMR_SAMPLE_HZ);
+		Start_LPTMR();
+	}
+#endif
 	__enable_irq();
+}
 
+void Tilt( void ) {
+	uint32_t events;
+	
+	Init_Sampling();
+
+	// ISRs only post events; the sensor work runs here at thread level
 	while (1) {
-			__wfi() ;
+		Power_Set_Mode(Power_Select_Mode(Time_To_Next_Wake_us(), Sleep_Needs()));
+		events = Wait_For_Events();
+		if (events & EV_SAMPLE) {
+			Process_Tilt();
+#if WAKE_SOURCE == WAKE_ON_MMA_INT
+			Enable_MMA_Int();
+#endif
+			if (Boot_Latency_Cycles == 0)
+				Boot_Latency_Cycles = Get_Cycles();
+		}
 	}
 }
 
 int main (void) {
 	
+	Start_Cycle_Counter();
 	Init_RGB_LEDs();
 	Control_RGB_LEDs(0, 0, 0);			// yellow: starting up 
 	i2c_init();											// init i2c
-	Init_Accel();										// init accelerometer
-		// Allow low leakage stop mode
-		SMC->PMPROT = SMC_PMPROT_ALLS_MASK; // 
-		// Enable low-leakage stop mode and regular run mode
-		SMC->PMCTRL = SMC_PMCTRL_STOPM(3) | SMC_PMCTRL_RUNM(0);
-		SMC->STOPCTRL = SMC_STOPCTRL_PSTOPO(0) | SMC_STOPCTRL_VLLSM(3);
+	Warm_Boot = Is_Warm_Wake();
+	if (Warm_Boot)
+		Resume_Tilt();								// accelerometer still running
+	else
+		Init_Accel();									// init accelerometer
+
+	// Allow the low power modes, stop depth is picked before each sleep
+	Init_Power();
 	
-		// Enable LLWU
-		// allow LPTMR0 to wake LLWU
-		LLWU->ME |= LLWU_ME_WUME0_MASK;
+	// Enable LLWU
+#if WAKE_SOURCE == WAKE_ON_LPTMR
+	// allow LPTMR0 to wake LLWU
+	LLWU->ME |= LLWU_ME_WUME0_MASK;
+#endif	// else MMA INT pin is enabled in Init_MMA_Int
 	
-	// Enable stop mode (deep sleep)
-		SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+#if USE_RTX
+	osKernelInitialize();
+#if USE_TICKLESS_IDLE
+	Init_Tickless();
+#endif
+#if USE_THREAD_STATS
+	Init_Thread_Stats();
+#endif
+	Start_Pipeline();								// sampling thread calls Init_Sampling
+	osKernelStart();
+	osThreadTerminate(osThreadGetId());
+#else
 	Tilt();
+#endif
 }
@@ -3,8 +3,17 @@
 #include "mma8451.h"
 #include "gpio_defs.h"
 #include "i2c.h"
+#include "config.h"
 
-
+// F_READ mode: reads auto-increment over the MSB registers only (XHI, YHI, ZHI),
+// so a sample is one 3-byte burst and the FIFO also drains 3 bytes per sample
+#if USE_MMA_FAST_READ
+#define MMA_READ_MODE (CTRL1_F_READ)
+#define MMA_SAMPLE_BYTES (3)
+#else
+#define MMA_READ_MODE (0)
+#define MMA_SAMPLE_BYTES (6)
+#endif
 
 //initializes mma8451 sensor
 //i2c has to already be enabled
@@ -13,27 +22,304 @@ int init_mma()
 	uint8_t data[2];
 
 	//set active mode, low noise, 14 bit samples, 2g full scale and 800 Hz ODR 
-	data[0] = 0x05;
+	data[0] = 0x05 | MMA_READ_MODE;
 	// only 2x oversampling at 800 Hz ODR
 	data[1] = 0x00;
 
-	i2c_write_bytes(MMA_ADDR, REG_CTRL1, data, 2);
-	return 1;
+	return i2c_write_bytes(MMA_ADDR, REG_CTRL1, data, 2) == I2C_OK;
 }
 
-void read_full_xyz(int16_t * acc)
+static uint8_t xyz_data[MMA_SAMPLE_BYTES];
+static I2C_XFER_T xyz_xfer;
+
+#if USE_MMA_FAST_READ
+// 8-bit MSB per axis (64 counts/g), scaled up so COUNTS_PER_G and the
+// activity thresholds still apply. The low 6 bits are always 0.
+static void convert_raw_xyz(uint8_t * data, int16_t * acc)
+{
+	int i;
+	
+	for ( i=0; i<3; i++ )
+		acc[i] = (int16_t) ((int8_t) data[i]) * 64;
+}
+#else
+static void convert_raw_xyz(uint8_t * data, int16_t * acc)
 {
 	int i;
-	uint8_t data[6];
 	int16_t temp[3];
 	
-	i2c_read_bytes(MMA_ADDR, REG_XHI, data, 6);
-
 	for ( i=0; i<3; i++ ) {
 		temp[i] = (int16_t) ((data[2*i]<<8) | data[2*i+1]);
 		acc[i] = temp[i]/4; 	// Align for 14 bits
 	}
 }
+#endif
+
+// Register read using the interrupt-driven engine when it is enabled
+static int mma_read(uint8_t reg_adx, uint8_t * data, uint8_t data_count)
+{
+#if USE_ASYNC_I2C
+	I2C_XFER_T xfer;
+	
+	xfer.Dev_Adx = MMA_ADDR;
+	xfer.Reg_Adx = reg_adx;
+	xfer.Data = data;
+	xfer.Count = data_count;
+	xfer.Read = 1;
+	xfer.Callback = 0;
+	xfer.Status = I2C_OK;
+	if (!i2c_submit(&xfer))
+		return 0;
+	return i2c_wait_async(&xfer) == I2C_OK;
+#else
+	return i2c_read_bytes(MMA_ADDR, reg_adx, data, data_count) == I2C_OK;
+#endif
+}
+
+//set up mma8451 to buffer samples in its 32-entry FIFO so several samples
+//can be read per wakeup in one burst. Use mma_set_interrupts to get a
+//watermark interrupt.
+int init_mma_fifo(uint8_t odr, uint8_t watermark)
+{
+	uint8_t data[2];
+
+	data[0] = 0x00;									// standby: F_SETUP and CTRL1 can only change when inactive
+	if (i2c_write_bytes(MMA_ADDR, REG_CTRL1, data, 1) != I2C_OK)
+		return 0;									// sensor not answering
+
+	// circular mode keeps the newest MMA_FIFO_SIZE samples if we are late reading
+	data[0] = F_SETUP_MODE_CIRCULAR | F_SETUP_WMRK(watermark);
+	if (i2c_write_bytes(MMA_ADDR, REG_F_SETUP, data, 1) != I2C_OK)
+		return 0;
+
+	data[0] = CTRL1_DR(odr) | CTRL1_LNOISE | MMA_READ_MODE | CTRL1_ACTIVE;
+	data[1] = 0x00;									// CTRL2: normal oversampling
+	return i2c_write_bytes(MMA_ADDR, REG_CTRL1, data, 2) == I2C_OK;
+}
+
+//enable the interrupt sources in enable_mask (INT_EN_*) and route those in
+//int1_mask to INT1, the rest to INT2. Sensor is briefly put in standby.
+//Returns 0 if any access failed.
+int mma_set_interrupts(uint8_t enable_mask, uint8_t int1_mask)
+{
+	uint8_t ctrl1, data[2];
+	int ok;
+	
+	if (!mma_read(REG_CTRL1, &ctrl1, 1))
+		return 0;
+	data[0] = ctrl1 & ~CTRL1_ACTIVE;
+	ok = i2c_write_bytes(MMA_ADDR, REG_CTRL1, data, 1) == I2C_OK;
+
+	data[0] = enable_mask;					// CTRL4
+	data[1] = int1_mask;						// CTRL5
+	ok &= i2c_write_bytes(MMA_ADDR, REG_CTRL4, data, 2) == I2C_OK;
+
+	ok &= i2c_write_bytes(MMA_ADDR, REG_CTRL1, &ctrl1, 1) == I2C_OK;
+	return ok;
+}
+
+//1 if the sensor acknowledged the write
+static int mma_write_reg(uint8_t reg_adx, uint8_t value)
+{
+	return i2c_write_bytes(MMA_ADDR, reg_adx, &value, 1) == I2C_OK;
+}
+
+//change output data rate, oversampling mode and FIFO watermark on the fly 
+//(watermark 0: FIFO not in use, leave it alone). Sensor is briefly put in 
+//standby; other CTRL1 bits are kept. Returns 0 if any access failed.
+int mma_set_rate(uint8_t odr, uint8_t mods, uint8_t watermark)
+{
+	uint8_t ctrl1;
+	int ok;
+	
+	if (!mma_read(REG_CTRL1, &ctrl1, 1))
+		return 0;
+	ok = mma_write_reg(REG_CTRL1, ctrl1 & ~CTRL1_ACTIVE);
+	if (watermark)
+		ok &= mma_write_reg(REG_F_SETUP, F_SETUP_MODE_CIRCULAR | F_SETUP_WMRK(watermark));
+	ok &= mma_write_reg(REG_CTRL2, CTRL2_MODS(mods));
+	ok &= mma_write_reg(REG_CTRL1, (ctrl1 & ~CTRL1_DR(0x07)) | CTRL1_DR(odr) | CTRL1_ACTIVE);
+	return ok;
+}
+
+static uint8_t tilt_odr;
+
+//use the freefall/motion engine and the transient engine (with its high-pass 
+//filter bypassed, so it is a second motion engine) to report tilt zone 
+//changes on INT1. Call mma_watch_tilt_zone to arm them for the current zone.
+int mma_init_tilt_engines(uint8_t odr)
+{
+	int ok;
+	
+	tilt_odr = odr;
+	ok = mma_write_reg(REG_CTRL1, 0x00);			// standby
+	ok &= mma_write_reg(REG_FF_MT_COUNT, TILT_DEBOUNCE);
+	ok &= mma_write_reg(REG_TRANSIENT_COUNT, TILT_DEBOUNCE);
+	ok &= mma_write_reg(REG_CTRL4, INT_EN_FF_MT | INT_EN_TRANS);
+	ok &= mma_write_reg(REG_CTRL5, INT_EN_FF_MT | INT_EN_TRANS); // both on INT1
+	return ok && mma_watch_tilt_zone(0);
+}
+
+//arm the engines to fire when tilt leaves zone (0: <15, 1: 15-30, 2: >30 deg)
+//  zone 0: FF_MT motion above 15
+//  zone 1: FF_MT freefall below 15, TRANSIENT above 30
+//  zone 2: FF_MT freefall below 30
+//Returns 0 if any write failed: the engines may then be left in standby.
+int mma_watch_tilt_zone(int zone)
+{
+	uint8_t ff_mt_cfg = FF_MT_CFG_ELE | FF_MT_CFG_XEFE | FF_MT_CFG_YEFE;
+	uint8_t ff_mt_ths = TILT_THS_15;
+	uint8_t trans_cfg = 0;
+	int ok;
+	
+	switch (zone) {
+		case 0:
+			ff_mt_cfg |= FF_MT_CFG_OAE;
+			break;
+		case 1:
+			trans_cfg = TRANSIENT_CFG_ELE | TRANSIENT_CFG_HPF_BYP | 
+				TRANSIENT_CFG_XTEFE | TRANSIENT_CFG_YTEFE;
+			break;
+		default:
+			ff_mt_ths = TILT_THS_30;
+			break;
+	}
+	ok = mma_write_reg(REG_CTRL1, 0x00);			// engines can only be changed in standby
+	ok &= mma_write_reg(REG_FF_MT_CFG, ff_mt_cfg);
+	ok &= mma_write_reg(REG_FF_MT_THS, THS_DBCNTM | ff_mt_ths);
+	ok &= mma_write_reg(REG_TRANSIENT_CFG, trans_cfg);
+	ok &= mma_write_reg(REG_TRANSIENT_THS, THS_DBCNTM | TILT_THS_30);
+	ok &= mma_write_reg(REG_CTRL1, CTRL1_DR(tilt_odr) | CTRL1_LNOISE | CTRL1_ACTIVE);
+	return ok;
+}
+
+//true if the sensor is still configured and sampling, as after an MCU VLLS 
+//wake. Also recovers the ODR used by mma_watch_tilt_zone.
+int mma_is_active(void)
+{
+	uint8_t ctrl1;
+	
+	if (!mma_read(REG_CTRL1, &ctrl1, 1))
+		return 0;
+	tilt_odr = (ctrl1 >> 3) & 0x07;
+	return (ctrl1 & CTRL1_ACTIVE) != 0;
+}
+
+//CTRL1_DR code the sensor is running at, -1 if it cannot be read
+int mma_get_odr(void)
+{
+	uint8_t ctrl1;
+	
+	if (!mma_read(REG_CTRL1, &ctrl1, 1))
+		return -1;
+	return (ctrl1 >> 3) & 0x07;
+}
+
+//zone the tilt engines are currently armed for (see mma_watch_tilt_zone)
+int mma_get_tilt_zone(void)
+{
+	uint8_t ff_mt_cfg, ff_mt_ths;
+	
+	if (!mma_read(REG_FF_MT_CFG, &ff_mt_cfg, 1) || !mma_read(REG_FF_MT_THS, &ff_mt_ths, 1))
+		return 0;
+	if (ff_mt_cfg & FF_MT_CFG_OAE)
+		return 0;
+	if ((ff_mt_ths & ~THS_DBCNTM) == TILT_THS_30)
+		return 2;
+	return 1;
+}
+
+//read (and so clear) the engine source registers. Returns TILT_EVENT_* mask.
+int mma_get_tilt_events(void)
+{
+	uint8_t src;
+	int events = 0;
+	
+	if (mma_read(REG_FF_MT_SRC, &src, 1) && (src & FF_MT_SRC_EA))
+		events |= TILT_EVENT_FF_MT;
+	if (mma_read(REG_TRANSIENT_SRC, &src, 1) && (src & TRANSIENT_SRC_EA))
+		events |= TILT_EVENT_TRANSIENT;
+	return events;
+}
+
+//read all samples waiting in the FIFO with a single burst (up to 192 bytes,
+//96 in F_READ mode).
+//Returns number of samples stored in acc.
+int read_fifo_xyz(int16_t acc[][3], int max_samples)
+{
+	static uint8_t data[MMA_FIFO_SIZE*MMA_SAMPLE_BYTES];
+	uint8_t status;
+	int i, n;
+	
+	if (!mma_read(REG_F_STATUS, &status, 1))
+		return 0;
+	n = status & F_STATUS_CNT_MASK;
+	if (n > max_samples)
+		n = max_samples;
+	if (n == 0)
+		return 0;
+	// with the FIFO enabled the address pointer wraps from REG_ZLO (REG_ZHI
+	// in F_READ mode) back to REG_XHI
+	if (!mma_read(REG_XHI, data, n*MMA_SAMPLE_BYTES))
+		return 0;
+	for (i=0; i<n; i++)
+		convert_raw_xyz(&data[MMA_SAMPLE_BYTES*i], acc[i]);
+	return n;
+}
+
+//reduce a block of samples to their mean
+void average_xyz(int16_t acc[][3], int num_samples, int16_t * avg)
+{
+	int32_t sum[3] = {0, 0, 0};
+	int i, j;
+	
+	for (i=0; i<num_samples; i++)
+		for (j=0; j<3; j++)
+			sum[j] += acc[i][j];
+	for (j=0; j<3; j++)
+		avg[j] = sum[j]/num_samples;
+}
+
+//returns 0 (acc unchanged) if the sensor did not answer
+int read_full_xyz(int16_t * acc)
+{
+	uint8_t data[MMA_SAMPLE_BYTES];
+	
+	if (i2c_read_bytes(MMA_ADDR, REG_XHI, data, MMA_SAMPLE_BYTES) != I2C_OK)
+		return 0;
+	convert_raw_xyz(data, acc);
+	return 1;
+}
+
+// Start an interrupt-driven read of XYZ. callback (may be 0) runs in I2C0_IRQHandler
+// when done; then get_xyz_result converts the data.
+int start_read_xyz(I2C_CALLBACK_T callback)
+{
+	xyz_xfer.Dev_Adx = MMA_ADDR;
+	xyz_xfer.Reg_Adx = REG_XHI;
+	xyz_xfer.Data = xyz_data;
+	xyz_xfer.Count = MMA_SAMPLE_BYTES;
+	xyz_xfer.Read = 1;
+	xyz_xfer.Callback = callback;
+	return i2c_submit(&xyz_xfer);
+}
+
+int get_xyz_result(int16_t * acc)
+{
+	if (xyz_xfer.Status != I2C_OK)
+		return 0;
+	convert_raw_xyz(xyz_data, acc);
+	return 1;
+}
+
+// Same as read_full_xyz but the CPU sleeps instead of spinning during the transfer
+int read_full_xyz_wfi(int16_t * acc)
+{
+	if (!start_read_xyz(0))
+		return 0;
+	i2c_wait_async(&xyz_xfer);
+	return get_xyz_result(acc);
+}
 
 void convert_xyz_to_roll_pitch(int16_t * acc,
 	float * roll, float * pitch) {
@@ -44,4 +330,68 @@ void convert_xyz_to_roll_pitch(int16_t * acc,
 	*roll = atan2(ay, az)*180/M_PI;
 	*pitch = atan2(ax, sqrt(ay*ay + az*az))*180/M_PI;
 }
-	
\ No newline at end of file
+
+// Integer-only versions of the above for the M0+ (no FPU): roll and pitch in
+// centidegrees straight from counts.
+
+// Largest r with r*r <= n
+uint32_t isqrt32(uint32_t n)
+{
+	uint32_t root = 0, bit = 1UL << 30;
+	
+	while (bit > n)
+		bit >>= 2;
+	while (bit != 0) {
+		if (n >= root + bit) {
+			n -= root + bit;
+			root = (root >> 1) + bit;
+		} else {
+			root >>= 1;
+		}
+		bit >>= 2;
+	}
+	return root;
+}
+
+// atan(num/den) for 0 <= num <= den, in centidegrees (0 to 4500). 9th order odd
+// polynomial in Q15, about 0.001 deg error before rounding.
+static int32_t atan_cd(uint32_t num, uint32_t den)
+{
+	int32_t z, z2, p;
+	
+	z = (int32_t) ((num << 15) / den);
+	z2 = (z*z) >> 15;
+	p = ATAN_Q15_A9;
+	p = ATAN_Q15_A7 + ((p*z2) >> 15);
+	p = ATAN_Q15_A5 + ((p*z2) >> 15);
+	p = ATAN_Q15_A3 + ((p*z2) >> 15);
+	p = ATAN_Q15_A1 + ((p*z2) >> 15);
+	p = (p*z) >> 15;												// radians, Q15
+	return (p*CD_PER_RAD + (1 << 14)) >> 15;
+}
+
+// atan2(y, x) in centidegrees, -18000 to 18000. |x|, |y| must be below 2^16.
+int16_t iatan2_cd(int32_t y, int32_t x)
+{
+	uint32_t ax = (x < 0) ? -x : x, ay = (y < 0) ? -y : y;
+	int32_t a;
+	
+	if (ax == 0 && ay == 0)
+		return 0;
+	if (ay <= ax)
+		a = atan_cd(ay, ax);
+	else
+		a = 9000 - atan_cd(ax, ay);
+	if (x < 0)
+		a = 18000 - a;
+	return (y < 0) ? -a : a;
+}
+
+void convert_xyz_to_roll_pitch_cd(int16_t * acc, int16_t * roll_cd, int16_t * pitch_cd)
+{
+	int32_t ax = acc[0], ay = acc[1], az = acc[2];
+	
+	*roll_cd = iatan2_cd(ay, az);
+	// scale by 4 before the square root to keep two more bits of the result
+	*pitch_cd = iatan2_cd(ax << 2, isqrt32((uint32_t) (ay*ay + az*az) << 4));
+}
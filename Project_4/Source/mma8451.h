@@ -2,6 +2,7 @@
 #define MMA8451_H
 
 #include <stdint.h>
+#include "i2c.h"
 
 #define MMA_ADDR 0x3A
 
@@ -12,17 +13,122 @@
 #define REG_ZHI	0x05
 #define REG_ZLO 0x06
 
+#define REG_F_STATUS 0x00
+#define REG_F_SETUP 0x09
+#define REG_FF_MT_CFG 0x15
+#define REG_FF_MT_SRC 0x16
+#define REG_FF_MT_THS 0x17
+#define REG_FF_MT_COUNT 0x18
+#define REG_TRANSIENT_CFG 0x1D
+#define REG_TRANSIENT_SRC 0x1E
+#define REG_TRANSIENT_THS 0x1F
+#define REG_TRANSIENT_COUNT 0x20
 #define REG_WHOAMI 0x0D
 #define REG_CTRL1  0x2A
+#define REG_CTRL2  0x2B
 #define REG_CTRL4  0x2D
+#define REG_CTRL5  0x2E
+
+// CTRL1 fields
+#define CTRL1_ACTIVE (0x01)
+#define CTRL1_F_READ (0x02)
+#define CTRL1_LNOISE (0x04)
+#define CTRL1_DR(x) (((x) & 0x07) << 3)
+
+// CTRL2 oversampling modes for CTRL2_MODS (active) and CTRL2_SMODS (auto-sleep)
+#define CTRL2_MODS(x) ((x) & 0x03)
+#define CTRL2_SMODS(x) (((x) & 0x03) << 3)
+#define MODS_NORMAL (0)
+#define MODS_LNLP (1)		// low noise low power
+#define MODS_HIRES (2)
+#define MODS_LP (3)			// low power: fewest internal samples per output
+
+// Output data rates for CTRL1_DR
+#define ODR_800HZ (0)
+#define ODR_400HZ (1)
+#define ODR_200HZ (2)
+#define ODR_100HZ (3)
+#define ODR_50HZ (4)
+#define ODR_12_5HZ (5)
+#define ODR_6_25HZ (6)
+#define ODR_1_56HZ (7)
+
+// FIFO
+#define MMA_FIFO_SIZE (32)
+#define F_STATUS_CNT_MASK (0x3F)
+#define F_STATUS_OVF (0x80)
+#define F_STATUS_WMRK (0x40)
+#define F_SETUP_MODE_CIRCULAR (0x40)
+#define F_SETUP_MODE_FILL (0x80)
+#define F_SETUP_WMRK(x) ((x) & 0x3F)
+
+// CTRL4 interrupt enables, CTRL5 routing (1 = INT1, 0 = INT2)
+#define INT_EN_DRDY (0x01)
+#define INT_EN_FF_MT (0x04)
+#define INT_EN_LNDPRT (0x10)
+#define INT_EN_TRANS (0x20)
+#define INT_EN_FIFO (0x40)
 
 #define WHOAMI 0x1A
 
+// FF_MT and TRANSIENT engine fields
+#define FF_MT_CFG_ELE (0x80)		// latch event until SRC is read
+#define FF_MT_CFG_OAE (0x40)		// 1: motion (any axis above THS), 0: freefall (all axes below)
+#define FF_MT_CFG_YEFE (0x10)
+#define FF_MT_CFG_XEFE (0x08)
+#define FF_MT_SRC_EA (0x80)
+#define TRANSIENT_CFG_ELE (0x10)
+#define TRANSIENT_CFG_YTEFE (0x04)
+#define TRANSIENT_CFG_XTEFE (0x02)
+#define TRANSIENT_CFG_HPF_BYP (0x01) // compare raw acceleration: a second motion detector
+#define TRANSIENT_SRC_EA (0x40)
+#define THS_DBCNTM (0x80)				// clear debounce counter when condition stops
+
+// Embedded engine thresholds are 0.063 g/count. A tilt of theta puts sin(theta) g
+// on X (pitch) or, when the other axis is level, on Y (roll).
+#define G_PER_THS_COUNT (0.063)
+#define TILT_THS(sin_deg) ((uint8_t) ((sin_deg)/G_PER_THS_COUNT + 0.5))
+#define SIN_15_DEG (0.258819)
+#define SIN_30_DEG (0.5)
+#define TILT_THS_15 TILT_THS(SIN_15_DEG)	// 4 counts, 14.6 deg
+#define TILT_THS_30 TILT_THS(SIN_30_DEG)	// 8 counts, 30.3 deg
+#define TILT_DEBOUNCE (2)							// samples a condition must persist
+
+// Events returned by mma_get_tilt_events
+#define TILT_EVENT_FF_MT (0x01)
+#define TILT_EVENT_TRANSIENT (0x02)
+
+// atan polynomial coefficients (Q15) and radians to centidegrees (Q0) for
+// the integer roll/pitch pipeline
+#define ATAN_Q15_A1 (32763)		//  0.9998660
+#define ATAN_Q15_A3 (-10823)	// -0.3302995
+#define ATAN_Q15_A5 (5903)		//  0.1801410
+#define ATAN_Q15_A7 (-2790)		// -0.0851330
+#define ATAN_Q15_A9 (683)			//  0.0208351
+#define CD_PER_RAD (5730)			// 18000/pi
+
 #define COUNTS_PER_G (4096.0)
 #define M_PI (3.14159265)
 
 int init_mma(void);
-void read_full_xyz(int16_t * acc);
+int init_mma_fifo(uint8_t odr, uint8_t watermark);
+int mma_set_interrupts(uint8_t enable_mask, uint8_t int1_mask);
+int mma_set_rate(uint8_t odr, uint8_t mods, uint8_t watermark);
+int mma_init_tilt_engines(uint8_t odr);
+int mma_watch_tilt_zone(int zone);
+int mma_get_tilt_events(void);
+int mma_is_active(void);
+int mma_get_odr(void);
+int mma_get_tilt_zone(void);
+int read_fifo_xyz(int16_t acc[][3], int max_samples);
+void average_xyz(int16_t acc[][3], int num_samples, int16_t * avg);
+int read_full_xyz(int16_t * acc);
+int start_read_xyz(I2C_CALLBACK_T callback);
+int get_xyz_result(int16_t * acc);
+int read_full_xyz_wfi(int16_t * acc);
 void convert_xyz_to_roll_pitch(int16_t * acc, float * roll, float * pitch);
+uint32_t isqrt32(uint32_t n);
+int16_t iatan2_cd(int32_t y, int32_t x);
+void convert_xyz_to_roll_pitch_cd(int16_t * acc, int16_t * roll_cd, int16_t * pitch_cd);
 
 #endif
@@ -0,0 +1,66 @@
+#include "MKL25Z4.h"
+#include "GPIO_defs.h"
+#include "mma_int.h"
+#include "events.h"
+#include "energy.h"
+
+volatile int32_t MMA_Int_count=0;
+
+// MMA8451 interrupt output is active low, push-pull (CTRL3 default). Use a 
+// level interrupt so a line already asserted when we come out of VLLS reset 
+// still fires; reading the sensor releases it.
+void Init_MMA_Int(void) {
+	SIM->SCGC5 |= MMA_INT_PORT_CLOCK_MASK;
+
+	Enable_MMA_Int();
+	MMA_INT_PT->PDDR &= ~MASK(MMA_INT_POS);
+
+	// Allow pin to wake from low-leakage stop modes
+	LLWU->F2 = MMA_INT_LLWU_F2;
+	LLWU->PE4 |= MMA_INT_LLWU_PE4;
+
+	// Configure NVIC 
+	NVIC_SetPriority(MMA_INT_IRQn, 3); 
+	NVIC_ClearPendingIRQ(MMA_INT_IRQn); 
+	NVIC_EnableIRQ(MMA_INT_IRQn);	
+	NVIC_SetPriority(LLWU_IRQn, 3); 
+	NVIC_ClearPendingIRQ(LLWU_IRQn); 
+	NVIC_EnableIRQ(LLWU_IRQn);	
+}
+
+// Level interrupt stays asserted until the sensor is read, so mask it here
+// and let the main loop re-enable it after processing the sample.
+void Enable_MMA_Int(void) {
+	MMA_INT_PORT->PCR[MMA_INT_POS] = PORT_PCR_MUX(1) | PORT_PCR_ISF_MASK | PORT_PCR_IRQC(8); // GPIO, interrupt when logic 0
+	NVIC_EnableIRQ(LLWU_IRQn);				// in case LLWU_IRQHandler stepped aside for the LPTMR
+}
+
+void PORTD_IRQHandler(void) {
+	uint32_t start;
+	
+	ISR_TIMING_START(start)
+	MMA_INT_PORT->PCR[MMA_INT_POS] = PORT_PCR_MUX(1) | PORT_PCR_ISF_MASK; // clear flag, disable interrupt
+	
+	MMA_Int_count++;
+	ENERGY_WAKE(WAKE_SRC_LLWU_PIN);
+	Post_Event(EV_SAMPLE);
+	ISR_TIMING_END(start)
+}
+
+// A pin wake from LLS or VLLS leaves WUF14 set until it is written with 1,
+// and the next low-leakage stop would be cut short by it. PORTD_IRQHandler
+// also runs once the port is clocked again (the line is still low) and
+// counts the wake; both post EV_SAMPLE before the main loop looks, so it
+// is taken once.
+void LLWU_IRQHandler(void) {
+	if (LLWU->F2 & MMA_INT_LLWU_F2) {
+		LLWU->F2 = MMA_INT_LLWU_F2;						// write 1 to clear
+		Post_Event(EV_SAMPLE);
+	}
+	// A module wake (LPTMR under tickless idle) holds the request until the
+	// module's own ISR clears its flag, which at equal priority would never
+	// run. Step aside; Enable_MMA_Int lets the LLWU in again.
+	if (LLWU->F3)
+		NVIC_DisableIRQ(LLWU_IRQn);
+}
+
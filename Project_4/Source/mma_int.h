@@ -0,0 +1,20 @@
+#ifndef MMA_INT_H
+#define MMA_INT_H
+#include "MKL25Z4.h"
+
+// The FRDM-KL25Z routes MMA8451 INT1 to PTA14, which is not an LLWU input and
+// so cannot wake the MCU from LLS or VLLS. Jumper PTA14 to PTD4 (LLWU_P14).
+#define MMA_INT_PORT PORTD
+#define MMA_INT_PT PTD
+#define MMA_INT_POS (4)
+#define MMA_INT_IRQn PORTD_IRQn
+#define MMA_INT_PORT_CLOCK_MASK SIM_SCGC5_PORTD_MASK
+#define MMA_INT_LLWU_PE4 LLWU_PE4_WUPE14(2)	// wake on falling edge of LLWU_P14
+#define MMA_INT_LLWU_F2 LLWU_F2_WUF14_MASK
+
+void Init_MMA_Int(void);
+void Enable_MMA_Int(void);
+
+extern volatile int32_t MMA_Int_count;
+
+#endif
@@ -0,0 +1,141 @@
+#include "MKL25Z4.h"
+#include "config.h"
+#if USE_RTX
+#include "cmsis_os.h"
+#include "mma8451.h"
+#include "mma_int.h"
+#include "tilt.h"
+#include "activity.h"
+#include "events.h"
+#include "pipeline.h"
+#include "thread_stats.h"
+
+// Priorities rise along the pipeline: a block that has been read is pushed
+// through to the LED before the next read starts. The sampling thread spends
+// most of its time blocked on the I2C engine, so it rarely holds anyone up.
+// The RTX timer thread, which only runs the thread statistics report, sits
+// below all three.
+static void Sample_Thread(void const * arg);
+static void Process_Thread(void const * arg);
+static void Output_Thread(void const * arg);
+
+osThreadDef(Sample_Thread, SAMPLE_PRIORITY, 1, SAMPLE_STACK_BYTES);
+osThreadDef(Process_Thread, PROCESS_PRIORITY, 1, PROCESS_STACK_BYTES);
+osThreadDef(Output_Thread, OUTPUT_PRIORITY, 1, OUTPUT_STACK_BYTES);
+
+osMailQDef(sample_q, PIPE_SAMPLE_MAILS, SAMPLE_MAIL_T);
+osMailQDef(zone_q, PIPE_ZONE_MAILS, ZONE_MAIL_T);
+static osMailQId sample_q, zone_q;
+
+PIPE_STATS_T Pipe_Stats;
+
+// Wait for EV_SAMPLE, read the sensor through the async I2C engine (thread
+// blocks, others run) and pass the block on. If processing is behind, the
+// samples stay in the sensor FIFO until a mail is freed. The MMA interrupt
+// stays masked meanwhile: it is level triggered and would fire again at once.
+static void Sample_Thread(void const * arg) {
+	SAMPLE_MAIL_T * mail;
+	uint32_t start;
+
+	(void) arg;
+#if USE_THREAD_STATS
+	Thread_Stats_Register("sample", SAMPLE_STACK_BYTES);
+#endif
+	Init_Sampling();
+	while (1) {
+		if (!(Wait_For_Events() & EV_SAMPLE))
+			continue;
+		start = Get_Cycles();
+		mail = osMailAlloc(sample_q, 0);
+		if (!mail) {
+			Pipe_Stats.Sample_Drops++;
+			THREAD_BLOCK();
+			mail = osMailAlloc(sample_q, osWaitForever);
+			THREAD_WAKE();
+			if (!mail)
+				continue;
+		}
+#if USE_MMA_FIFO
+		mail->Count = read_fifo_xyz(mail->Acc, MMA_FIFO_SIZE);
+#else
+		mail->Count = read_full_xyz_wfi(mail->Acc[0]);
+#endif
+		mail->Start = start;
+		if (mail->Count > 0) {
+			Pipe_Stats.Blocks++;
+			osMailPut(sample_q, mail);
+		} else {
+			osMailFree(sample_q, mail);
+		}
+#if WAKE_SOURCE == WAKE_ON_MMA_INT
+		Enable_MMA_Int();
+#endif
+	}
+}
+
+// Filter a block down to one reading and classify it
+static void Process_Thread(void const * arg) {
+	osEvent evt;
+	SAMPLE_MAIL_T * in;
+	ZONE_MAIL_T * out;
+	int16_t acc[3];
+
+	(void) arg;
+#if USE_THREAD_STATS
+	Thread_Stats_Register("process", PROCESS_STACK_BYTES);
+#endif
+	while (1) {
+		THREAD_BLOCK();
+		evt = osMailGet(sample_q, osWaitForever);
+		THREAD_WAKE();
+		if (evt.status != osEventMail)
+			continue;
+		in = (SAMPLE_MAIL_T *) evt.value.p;
+		average_xyz(in->Acc, in->Count, acc);
+#if USE_ACTIVITY_CONTROL
+		Update_Activity(acc, in->Count);
+#endif
+		out = osMailAlloc(zone_q, 0);
+		if (out) {
+			out->Zone = classify_tilt_zone(acc);
+			out->Start = in->Start;
+			osMailPut(zone_q, out);
+		} else {
+			Pipe_Stats.Zone_Drops++;
+		}
+		osMailFree(sample_q, in);
+	}
+}
+
+static void Output_Thread(void const * arg) {
+	osEvent evt;
+	ZONE_MAIL_T * mail;
+
+	(void) arg;
+#if USE_THREAD_STATS
+	Thread_Stats_Register("output", OUTPUT_STACK_BYTES);
+#endif
+	while (1) {
+		THREAD_BLOCK();
+		evt = osMailGet(zone_q, osWaitForever);
+		THREAD_WAKE();
+		if (evt.status != osEventMail)
+			continue;
+		mail = (ZONE_MAIL_T *) evt.value.p;
+		Show_Tilt_Zone(mail->Zone);
+		Pipe_Stats.Latency_Cycles = Get_Cycles() - mail->Start;
+		if (Pipe_Stats.Latency_Cycles > Pipe_Stats.Max_Latency_Cycles)
+			Pipe_Stats.Max_Latency_Cycles = Pipe_Stats.Latency_Cycles;
+		osMailFree(zone_q, mail);
+	}
+}
+
+// Call between osKernelInitialize and osKernelStart
+void Start_Pipeline(void) {
+	sample_q = osMailCreate(osMailQ(sample_q), NULL);
+	zone_q = osMailCreate(osMailQ(zone_q), NULL);
+	osThreadCreate(osThread(Output_Thread), NULL);
+	osThreadCreate(osThread(Process_Thread), NULL);
+	osThreadCreate(osThread(Sample_Thread), NULL);
+}
+#endif
@@ -0,0 +1,54 @@
+#ifndef PIPELINE_H
+#define PIPELINE_H
+#include <stdint.h>
+#include "mma8451.h"
+
+// RTX threads: sampling -> processing -> output, linked by mail queues
+
+// Thread stacks in bytes, multiples of 8 as RTX allocates them. Each must
+// hold the 64 byte exception and context frame; the mails live in the queue
+// pools, not on the stacks. Processing goes deepest, through the float
+// library when USE_TILT_CLASSIFIER is 0.
+#define SAMPLE_STACK_BYTES (256)
+#define PROCESS_STACK_BYTES (384)
+#define OUTPUT_STACK_BYTES (192)
+
+// Thread priorities. RTX_Conf_CM.c checks they differ from each other and
+// from the timer thread's OS_TIMERPRIO.
+#define SAMPLE_PRIORITY osPriorityNormal
+#define PROCESS_PRIORITY osPriorityAboveNormal
+#define OUTPUT_PRIORITY osPriorityHigh
+
+// What OS_PRIVCNT and OS_PRIVSTKSIZE in RTX_Conf_CM.c must cover
+#define PIPE_THREADS (3)
+#define PIPE_STACK_WORDS ((SAMPLE_STACK_BYTES + PROCESS_STACK_BYTES + OUTPUT_STACK_BYTES)/4)
+
+// Block of raw samples from one wake, sampling -> processing
+typedef struct {
+	int16_t Acc[MMA_FIFO_SIZE][3];
+	uint8_t Count;
+	uint32_t Start;							// Get_Cycles when the wake event was taken
+} SAMPLE_MAIL_T;
+
+// Classified result, processing -> output
+typedef struct {
+	uint8_t Zone;
+	uint32_t Start;
+} ZONE_MAIL_T;
+
+typedef struct {
+	uint32_t Blocks;						// sample blocks read
+	uint32_t Sample_Drops;			// no free sample mail, block left in the sensor until one is freed
+	uint32_t Zone_Drops;				// no free zone mail, result lost
+	uint32_t Latency_Cycles;		// wake event to LED on, latest
+	uint32_t Max_Latency_Cycles;
+} PIPE_STATS_T;
+
+extern PIPE_STATS_T Pipe_Stats;
+
+void Start_Pipeline(void);
+
+// In main.c: starts the EV_SAMPLE source, called by the sampling thread
+void Init_Sampling(void);
+
+#endif
@@ -0,0 +1,77 @@
+#include "MKL25Z4.h"
+#include "GPIO_defs.h"
+#include "config.h"
+#include "power.h"
+
+// Wake latencies are the datasheet run-mode recovery times. VLLS3 wakes
+// through reset, so its real cost also includes main()'s re-initialization
+// (PWR_VLLS3_MIN_US). Check them on the board with PWR_DEBUG_PINS: DEBUG3 is
+// high while asleep, so latency = wake source edge to DEBUG3 falling edge.
+const PWR_MODE_INFO_T Power_Modes[PWR_NUM_MODES] = {
+	{"WAIT",  1,  0,                PWR_NEED_BUS_CLOCK | PWR_NEED_MCGIRCLK | PWR_NEED_REGISTERS},
+	{"VLPS",  5,  0,                PWR_NEED_MCGIRCLK | PWR_NEED_REGISTERS},
+	{"LLS",   5,  PWR_LLS_MIN_US,   PWR_NEED_REGISTERS},
+	{"VLLS3", 53, PWR_VLLS3_MIN_US, 0}
+};
+
+void Init_Power(void) {
+	// Allow VLPx, LLS and VLLSx (write-once after reset)
+	SMC->PMPROT = SMC_PMPROT_AVLP_MASK | SMC_PMPROT_ALLS_MASK | SMC_PMPROT_AVLLS_MASK;
+	
+	// After a VLLS wake the pins are held until peripherals are set up again
+	if (PMC->REGSC & PMC_REGSC_ACKISO_MASK)
+		PMC->REGSC |= PMC_REGSC_ACKISO_MASK;
+
+#if PWR_DEBUG_PINS
+	SIM->SCGC5 |= SIM_SCGC5_PORTB_MASK;
+	PORTB->PCR[DEBUG1_POS] = PORT_PCR_MUX(1);
+	PORTB->PCR[DEBUG2_POS] = PORT_PCR_MUX(1);
+	PORTB->PCR[DEBUG3_POS] = PORT_PCR_MUX(1);
+	PTB->PDDR |= MASK(DEBUG1_POS) | MASK(DEBUG2_POS) | MASK(DEBUG3_POS);
+	PTB->PCOR = MASK(DEBUG1_POS) | MASK(DEBUG2_POS) | MASK(DEBUG3_POS);
+#endif
+}
+
+// Deepest mode that keeps everything in needs and can wake in time for the
+// next scheduled event. WAIT keeps everything, so it is the fallback.
+PWR_MODE_T Power_Select_Mode(uint32_t deadline_us, uint32_t needs) {
+	int mode;
+	
+	for (mode = PWR_VLLS3; mode > PWR_WAIT; mode--) {
+		if (((Power_Modes[mode].Keeps & needs) == needs) &&
+			(deadline_us >= Power_Modes[mode].Min_Sleep_us + Power_Modes[mode].Wake_Latency_us))
+			break;
+	}
+	return (PWR_MODE_T) mode;
+}
+
+static PWR_MODE_T current_mode = PWR_WAIT;
+
+PWR_MODE_T Power_Get_Mode(void) {
+	return current_mode;
+}
+
+// Set up the mode the next __wfi enters
+void Power_Set_Mode(PWR_MODE_T mode) {
+	volatile uint8_t dummy;
+	
+	current_mode = mode;
+	switch (mode) {
+		case PWR_WAIT:
+			SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+			return;
+		case PWR_VLPS:
+			SMC->PMCTRL = SMC_PMCTRL_STOPM(2) | SMC_PMCTRL_RUNM(0);
+			break;
+		case PWR_LLS:
+			SMC->PMCTRL = SMC_PMCTRL_STOPM(3) | SMC_PMCTRL_RUNM(0);
+			break;
+		default:
+			SMC->STOPCTRL = SMC_STOPCTRL_PSTOPO(0) | SMC_STOPCTRL_VLLSM(3);
+			SMC->PMCTRL = SMC_PMCTRL_STOPM(4) | SMC_PMCTRL_RUNM(0);
+			break;
+	}
+	dummy = SMC->PMCTRL;			// make sure the write lands before WFI
+	(void) dummy;
+	SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+}
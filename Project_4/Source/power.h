@@ -0,0 +1,29 @@
+#ifndef POWER_H
+#define POWER_H
+#include <stdint.h>
+
+// Stop depths, lightest first
+typedef enum {PWR_WAIT, PWR_VLPS, PWR_LLS, PWR_VLLS3, PWR_NUM_MODES} PWR_MODE_T;
+
+// What must keep working while asleep
+#define PWR_NEED_BUS_CLOCK (1UL << 0)	// I2C or UART transfer in flight
+#define PWR_NEED_MCGIRCLK (1UL << 1)	// TPM counting MCGIRCLK (LED pulse)
+#define PWR_NEED_REGISTERS (1UL << 2)	// peripheral registers and RAM state kept, no reset on wake
+
+#define PWR_NO_DEADLINE (0xFFFFFFFFUL)
+
+typedef struct {
+	char * Name;
+	uint32_t Wake_Latency_us;		// wake event to first instruction, KL25 datasheet typical
+	uint32_t Min_Sleep_us;			// shortest sleep worth entering this mode for
+	uint32_t Keeps;							// PWR_NEED_* still available in this mode
+} PWR_MODE_INFO_T;
+
+extern const PWR_MODE_INFO_T Power_Modes[PWR_NUM_MODES];
+
+void Init_Power(void);
+PWR_MODE_T Power_Select_Mode(uint32_t deadline_us, uint32_t needs);
+void Power_Set_Mode(PWR_MODE_T mode);
+PWR_MODE_T Power_Get_Mode(void);
+
+#endif
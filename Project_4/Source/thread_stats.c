@@ -0,0 +1,205 @@
+#include "MKL25Z4.h"
+#include "config.h"
+#if USE_RTX && USE_THREAD_STATS
+#include "cmsis_os.h"
+#include "events.h"
+#include "thread_stats.h"
+
+// RTX 4 has no thread switch hook, so switches are tracked where they can
+// happen in this program: a thread starts running when it returns from a
+// blocking call and stops when it makes one. That only holds if no thread is
+// switched out while it is ready, so RTX_Conf_CM.c requires OS_ROBIN 0 and a
+// timer thread priority apart from the pipeline threads', which differ from
+// each other. A thread that blocks then hands the CPU back to the one it
+// preempted, and the running threads form a stack. Empty stack means the
+// idle demon runs; main, which ends itself once the kernel starts, is
+// charged there too. ISR time is charged to whichever thread was interrupted.
+//
+// The blocking calls wrapped in THREAD_BLOCK/THREAD_WAKE are:
+//   Wait_For_Events (events.c)          osSignalWait
+//   i2c_wait_async, i2c_claim (i2c.c)   osSignalWait, osDelay
+//   Sample_Thread (pipeline.c)          osMailAlloc when no mail is free
+//   Process_Thread, Output_Thread       osMailGet
+// A new blocking call in a registered thread must be wrapped the same way, or
+// its thread keeps being charged while others run. The RTX timer thread is
+// only counted inside Report_Timer, its one callback: its own dispatch code
+// is charged to the thread it preempted, and any further osTimer callback
+// would have to call Thread_Stats_Wake/Block itself.
+//
+// The stack scan relies on RTX 4 internals: OS_STKCHECK putting
+// THREAD_STACK_MAGIC at each stack base and OS_STKINIT filling the stack with
+// THREAD_STACK_PATTERN. RTX_Conf_CM.c checks both options and the RTX version.
+
+THREAD_STATS_T Thread_Stats[THREAD_STATS_MAX];
+volatile uint32_t Thread_Stats_Period_Cycles;
+volatile uint32_t Thread_Stats_Reports;
+
+static int8_t running[THREAD_STATS_MAX];	// preemption stack of slots
+static int depth = 0;
+static int num_slots = 1;									// slot 0 is idle
+static uint32_t last_mark;
+
+static void Report_Timer(void const * arg);
+osTimerDef(Report_Timer, Report_Timer);
+
+// Stack base from the OS_STKCHECK magic word below the current stack pointer
+static uint32_t * Find_Stack_Base(int words) {
+	uint32_t * p = (uint32_t *) __get_PSP();
+	int n;
+
+	for (n = 0; n < words; n++, p--) {
+		if (*p == THREAD_STACK_MAGIC)
+			return p;
+	}
+	return 0;
+}
+
+// Bytes between the stack top and the lowest word no longer holding the fill
+static uint16_t Stack_High_Water(uint32_t * base, int words) {
+	uint32_t * p = base + 1;
+
+	while ((p < base + words) && (*p == THREAD_STACK_PATTERN))
+		p++;
+	return (base + words - p)*4;
+}
+
+static int Find_Slot(void * id) {
+	int i;
+
+	for (i = 1; i < num_slots; i++) {
+		if (Thread_Stats[i].Id == id)
+			return i;
+	}
+	return -1;
+}
+
+// Charge the time since the last switch to whoever was running.
+// Call with interrupts masked.
+static void Charge(uint32_t now) {
+	int slot = depth ? running[depth-1] : 0;
+
+	if ((int32_t) (now - last_mark) > 0) {		// a preempting thread may have moved it on
+		Thread_Stats[slot].Cycles += now - last_mark;
+		last_mark = now;
+	}
+}
+
+static void Push(int slot) {
+	if (depth < THREAD_STATS_MAX)
+		running[depth++] = slot;
+}
+
+static void Pop(int slot) {
+	int i;
+
+	for (i = depth-1; i >= 0; i--) {
+		if (running[i] == slot) {
+			for (; i < depth-1; i++)
+				running[i] = running[i+1];
+			depth--;
+			return;
+		}
+	}
+}
+
+// Build the report for the period just ended and start the next one
+static void Update_Report(void) {
+	uint32_t now = Get_Cycles(), total = 0, per_mille;	// SVC: not with interrupts masked
+	int i;
+
+	__disable_irq();
+	Charge(now);
+	for (i = 0; i < num_slots; i++)
+		total += Thread_Stats[i].Cycles;
+	per_mille = total/1000;
+	for (i = 0; i < num_slots; i++) {
+		Thread_Stats[i].CPU_pm = per_mille ? Thread_Stats[i].Cycles/per_mille : 0;
+		Thread_Stats[i].Cycles = 0;
+	}
+	__enable_irq();
+
+	Thread_Stats_Period_Cycles = total;
+	for (i = 0; i < num_slots; i++) {
+		if (Thread_Stats[i].Stack_Base)
+			Thread_Stats[i].Stack_Max_Bytes = Stack_High_Water(Thread_Stats[i].Stack_Base,
+				Thread_Stats[i].Stack_Words);
+	}
+	Thread_Stats_Reports++;
+}
+
+// Runs on the RTX timer thread, which is counted like any other
+static void Report_Timer(void const * arg) {
+	static int registered = 0;
+
+	(void) arg;
+	if (!registered) {
+		Thread_Stats_Register("timer", THREAD_STACK_WORDS*4);
+		registered = 1;
+	} else {
+		Thread_Stats_Wake();
+	}
+	Update_Report();
+	Thread_Stats_Block();
+}
+
+// Call between osKernelInitialize and osKernelStart
+void Init_Thread_Stats(void) {
+	osTimerId timer;
+
+	Thread_Stats[0].Name = "idle";
+	last_mark = Get_Cycles();
+	timer = osTimerCreate(osTimer(Report_Timer), osTimerPeriodic, NULL);
+	osTimerStart(timer, THREAD_STATS_PERIOD_MS);
+}
+
+// Call first thing in a thread function: the thread is running from here on.
+// stack_bytes is the size in its osThreadDef.
+void Thread_Stats_Register(const char * name, uint32_t stack_bytes) {
+	void * id = osThreadGetId();
+	uint32_t * base = Find_Stack_Base(stack_bytes/4);
+	uint32_t now = Get_Cycles();
+	int slot;
+
+	__disable_irq();
+	if (num_slots < THREAD_STATS_MAX) {
+		slot = num_slots++;
+		Thread_Stats[slot].Name = name;
+		Thread_Stats[slot].Id = id;
+		Thread_Stats[slot].Stack_Base = base;
+		Thread_Stats[slot].Stack_Words = stack_bytes/4;
+		Charge(now);
+		Push(slot);
+	}
+	__enable_irq();
+}
+
+// Called from os_idle_demon, only the stack is needed
+void Thread_Stats_Register_Idle(void) {
+	Thread_Stats[0].Stack_Base = Find_Stack_Base(THREAD_STACK_WORDS);
+	Thread_Stats[0].Stack_Words = THREAD_STACK_WORDS;
+}
+
+void Thread_Stats_Wake(void) {
+	int slot = Find_Slot(osThreadGetId());
+	uint32_t now = Get_Cycles();
+
+	if (slot < 0)
+		return;
+	__disable_irq();
+	Charge(now);
+	Push(slot);
+	__enable_irq();
+}
+
+void Thread_Stats_Block(void) {
+	int slot = Find_Slot(osThreadGetId());
+	uint32_t now = Get_Cycles();
+
+	if (slot < 0)
+		return;
+	__disable_irq();
+	Charge(now);
+	Pop(slot);
+	__enable_irq();
+}
+#endif
@@ -0,0 +1,42 @@
+#ifndef THREAD_STATS_H
+#define THREAD_STATS_H
+#include <stdint.h>
+#include "config.h"
+
+#define THREAD_STATS_MAX (6)							// idle plus registered threads
+#define THREAD_STACK_WORDS (50)						// idle and timer: must match OS_STKSIZE and OS_TIMERSTKSZ
+#define THREAD_STACK_PATTERN (0xCCCCCCCCUL)	// RTX fill with OS_STKINIT
+#define THREAD_STACK_MAGIC (0xE25A2EA5UL)		// RTX stack base word with OS_STKCHECK
+
+typedef struct {
+	const char * Name;
+	void * Id;											// osThreadId, 0 for idle
+	uint32_t * Stack_Base;					// 0 if not found
+	uint16_t Stack_Words;						// size given at registration
+	uint32_t Cycles;								// charged so far this period
+	uint16_t CPU_pm;								// share of the last period, per mille
+	uint16_t Stack_Max_Bytes;				// deepest use seen, of Stack_Words*4
+} THREAD_STATS_T;
+
+// Slot 0 is the idle demon (no thread running). Refreshed every
+// THREAD_STATS_PERIOD_MS by an RTX timer.
+extern THREAD_STATS_T Thread_Stats[THREAD_STATS_MAX];
+extern volatile uint32_t Thread_Stats_Period_Cycles;
+extern volatile uint32_t Thread_Stats_Reports;
+
+void Init_Thread_Stats(void);
+void Thread_Stats_Register(const char * name, uint32_t stack_bytes);
+void Thread_Stats_Register_Idle(void);
+void Thread_Stats_Wake(void);
+void Thread_Stats_Block(void);
+
+// Around every blocking RTX call a thread makes; thread_stats.c lists them
+#if USE_RTX && USE_THREAD_STATS
+#define THREAD_BLOCK() Thread_Stats_Block()
+#define THREAD_WAKE() Thread_Stats_Wake()
+#else
+#define THREAD_BLOCK()
+#define THREAD_WAKE()
+#endif
+
+#endif
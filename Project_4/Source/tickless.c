@@ -0,0 +1,93 @@
+#include "MKL25Z4.h"
+#include "GPIO_defs.h"
+#include "config.h"
+#if USE_RTX && USE_TICKLESS_IDLE
+#include "cmsis_os.h"
+#include "LPTimer.h"
+#include "power.h"
+#include "energy.h"
+#include "i2c.h"
+#include "led_pulse.h"
+#include "tickless.h"
+
+// RTX 4 scheduler suspend/resume (rt_CMSIS.c). os_suspend locks the scheduler
+// and returns the ticks until the next timeout; os_resume adds the ticks slept.
+extern uint32_t os_suspend(void);
+extern void os_resume(uint32_t sleep_time);
+
+TICKLESS_STATS_T Tickless_Stats;
+
+// LPTMR is the wake timer here, not the sample clock (config.h checks that)
+void Init_Tickless(void) {
+	SIM->SCGC5 |= SIM_SCGC5_LPTMR_MASK;
+
+	LPTMR0->CSR = 0;
+	LPTMR0->PSR = LPTMR_PSR_PBYP_MASK | LPTMR_PSR_PCS(1);		// 1 kHz LPO, 1 ms per count
+	NVIC_SetPriority(LPTimer_IRQn, 3);
+	NVIC_ClearPendingIRQ(LPTimer_IRQn);
+	NVIC_EnableIRQ(LPTimer_IRQn);
+	LLWU->ME |= LLWU_ME_WUME0_MASK;				// LPTMR0 can wake LLS
+
+	Tickless_Stats.Sleeps = 0;
+	Tickless_Stats.Ticks_Slept = 0;
+	Tickless_Stats.Early_Wakes = 0;
+}
+
+// What must keep working while asleep. RTX state lives in RAM, so never VLLS.
+static uint32_t Idle_Needs(void) {
+	uint32_t needs = PWR_NEED_REGISTERS;
+
+	if (i2c_busy_async())
+		needs |= PWR_NEED_BUS_CLOCK;
+#if USE_TPM_LED_PULSE
+	if (LED_Pulse_Active())
+		needs |= PWR_NEED_MCGIRCLK;
+#endif
+	return needs;
+}
+
+// Called from os_idle_demon. With SysTick stopped nothing wakes us for the
+// ticks in between, only the LPTMR at the next RTX timeout or an interrupt
+// that makes a thread ready. The partial tick in progress when we stop is lost.
+void Tickless_Idle(void) {
+	uint32_t ticks, slept;
+
+	ticks = os_suspend();				// 0xFFFF if no thread is waiting on time
+	if (ticks < TICKLESS_MIN_TICKS) {
+		os_resume(0);
+		Power_Set_Mode(PWR_WAIT);
+		__wfi();									// next tick or interrupt
+		return;
+	}
+
+	SysTick->CTRL &= ~SysTick_CTRL_ENABLE_Msk;
+	LPTMR0->CSR = 0;							// stop clears the count
+	LPTMR0->CMR = ticks - 1;
+	LPTMR0->CSR = LPTMR_CSR_TIE_MASK | LPTMR_CSR_TCF_MASK;
+	LPTMR0->CSR |= LPTMR_CSR_TEN_MASK;
+	Power_Set_Mode(Power_Select_Mode(ticks*TICKLESS_TICK_US, Idle_Needs()));
+
+	__disable_irq();							// so the count is read before the waking ISR runs
+#if USE_ENERGY_STATS
+	Energy_Sleep_Begin();
+#endif
+	__wfi();
+#if USE_ENERGY_STATS
+	Energy_Sleep_End();
+#endif
+	if (LPTMR0->CSR & LPTMR_CSR_TCF_MASK) {
+		slept = ticks;
+	} else {
+		LPTMR0->CNR = 0;						// latch the count to read it
+		slept = LPTMR0->CNR;
+		Tickless_Stats.Early_Wakes++;
+	}
+	LPTMR0->CSR &= ~LPTMR_CSR_TEN_MASK;	// a pending compare still runs the ISR
+	SysTick->VAL = 0;
+	__enable_irq();
+
+	Tickless_Stats.Sleeps++;
+	Tickless_Stats.Ticks_Slept += slept;
+	os_resume(slept);							// restarts SysTick, runs expired timeouts
+}
+#endif
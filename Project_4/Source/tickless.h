@@ -0,0 +1,23 @@
+#ifndef TICKLESS_H
+#define TICKLESS_H
+#include <stdint.h>
+
+// RTX tick period in us. One LPTMR count (LPO, prescaler bypassed) is one
+// tick, so this must match OS_TICK in RTX_Conf_CM.c.
+#define TICKLESS_TICK_US (1000)
+
+// Sleeps shorter than this many ticks just WFI with the tick running
+#define TICKLESS_MIN_TICKS (2)
+
+typedef struct {
+	uint32_t Sleeps;					// tickless sleeps taken
+	uint32_t Ticks_Slept;			// ticks skipped, added back to RTX on wake
+	uint32_t Early_Wakes;			// woken by something else before the LPTMR
+} TICKLESS_STATS_T;
+
+extern TICKLESS_STATS_T Tickless_Stats;
+
+void Init_Tickless(void);
+void Tickless_Idle(void);
+
+#endif
@@ -0,0 +1,194 @@
+#include "MKL25Z4.h"
+#include "LEDs.h"
+#include "led_pulse.h"
+#include "GPIO_defs.h"
+#include "Delay.h"
+#include "mma8451.h"
+#include "config.h"
+#include "tilt.h"
+#include "activity.h"
+#include "events.h"
+#include <math.h>
+
+	int16_t accel[3];
+	float roll, pitch;
+#if USE_MMA_FIFO
+	int16_t fifo_accel[MMA_FIFO_SIZE][3];
+#endif
+
+#if USE_MMA_TILT_ENGINE
+	static int tilt_zone = 0;
+#endif
+
+// Cost of the latest Process_Tilt call, for comparing the polled, async and
+// FIFO read paths: I2C bytes on the bus and core cycles (SysTick runs in WAIT)
+	uint32_t Tilt_Bus_Bytes, Tilt_Cycles, Tilt_Max_Cycles;
+	int Tilt_Samples;
+	uint32_t Tilt_Errors;				// sensor reads or writes that failed
+
+// Angle is beyond theta when opposite^2 > tan^2(theta) * adjacent^2 (adjacent >= 0)
+#define TILT_EXCEEDS(tan2_q24, opp2, adj2) \
+	(((uint64_t) (opp2) << 24) > (uint64_t) (tan2_q24) * (adj2))
+
+// F_READ samples carry only 8 bits per axis (|a| <= 128), so squares stay
+// below 2^15 and the same test fits in 32 bits with a Q16 tan^2
+#define TILT_EXCEEDS_8(tan2_q16, opp2, adj2) \
+	(((opp2) << 16) > (tan2_q16) * (adj2))
+
+// Zone of the larger of |roll| and |pitch| (0: <15, 1: 15-30, 2: >30 deg) from
+// raw counts, without computing an angle. Same decisions as comparing the
+// results of convert_xyz_to_roll_pitch against the zone limits.
+//   roll  = atan2(ay, az):                |roll| > t  <=>  ay^2 > tan^2(t) az^2 for az > 0
+//   pitch = atan2(ax, sqrt(ay^2 + az^2)): |pitch| > t <=>  ax^2 > tan^2(t) (ay^2 + az^2)
+#if USE_MMA_FAST_READ
+int classify_tilt_zone(int16_t acc[3]) {
+	int32_t ax = acc[0]/64, ay = acc[1]/64, az = acc[2]/64;	// back to the 8-bit MSB
+	uint32_t x2 = ax*ax, y2 = ay*ay, z2 = az*az;
+	
+	if ((az < 0) || ((az == 0) && (ay != 0)))	// |roll| >= 90
+		return 2;
+	if (TILT_EXCEEDS_8(TILT_TAN2_ZONE2_Q16, y2, z2) || TILT_EXCEEDS_8(TILT_TAN2_ZONE2_Q16, x2, y2 + z2))
+		return 2;
+	if (TILT_EXCEEDS_8(TILT_TAN2_ZONE1_Q16, y2, z2) || TILT_EXCEEDS_8(TILT_TAN2_ZONE1_Q16, x2, y2 + z2))
+		return 1;
+	return 0;
+}
+#else
+int classify_tilt_zone(int16_t acc[3]) {
+	int32_t ax = acc[0], ay = acc[1], az = acc[2];
+	uint32_t x2 = ax*ax, y2 = ay*ay, z2 = az*az;
+	
+	if ((az < 0) || ((az == 0) && (ay != 0)))	// |roll| >= 90
+		return 2;
+	if (TILT_EXCEEDS(TILT_TAN2_ZONE2, y2, z2) || TILT_EXCEEDS(TILT_TAN2_ZONE2, x2, y2 + z2))
+		return 2;
+	if (TILT_EXCEEDS(TILT_TAN2_ZONE1, y2, z2) || TILT_EXCEEDS(TILT_TAN2_ZONE1, x2, y2 + z2))
+		return 1;
+	return 0;
+}
+#endif
+
+// Flash the LED for a tilt zone: 0 green, 1 yellow, 2 red
+void Show_Tilt_Zone(int zone) {
+#if USE_TPM_LED_PULSE
+		LED_Pulse(zone >= 1, zone <= 1, 0, TILT_LED_PULSE_US);
+#else
+		if (zone >= 2)
+		Control_RGB_LEDs(1, 0, 0);
+		else if (zone == 1)
+		Control_RGB_LEDs(1, 1, 0);
+		else
+		Control_RGB_LEDs(0, 1, 0);
+      //Delay(1);
+		ShortDelay(50);
+			Control_RGB_LEDs(0, 0, 0);
+#endif
+}
+
+// Flash blue, which no zone uses, when the sensor could not be read or written
+void Show_Tilt_Error(void) {
+	Tilt_Errors++;
+#if USE_TPM_LED_PULSE
+		LED_Pulse(0, 0, 1, TILT_LED_PULSE_US);
+#else
+		Control_RGB_LEDs(0, 0, 1);
+		ShortDelay(50);
+		Control_RGB_LEDs(0, 0, 0);
+#endif
+}
+
+#if USE_MMA_TILT_ENGINE
+// Sensor reported leaving the current zone: step to the neighbouring zone and
+// re-arm. If we actually moved two zones, the re-armed engine fires again at once.
+static void Process_Tilt_Event(void) {
+	int events = mma_get_tilt_events();
+
+	switch (tilt_zone) {
+		case 0:
+			if (events & TILT_EVENT_FF_MT)
+				tilt_zone = 1;
+			break;
+		case 1:
+			if (events & TILT_EVENT_TRANSIENT)
+				tilt_zone = 2;
+			else if (events & TILT_EVENT_FF_MT)
+				tilt_zone = 0;
+			break;
+		default:
+			if (events & TILT_EVENT_FF_MT)
+				tilt_zone = 1;
+			break;
+	}
+	if (mma_watch_tilt_zone(tilt_zone))
+		Show_Tilt_Zone(tilt_zone);
+	else
+		Show_Tilt_Error();					// engines may be left unarmed
+}
+#endif
+
+#if !USE_MMA_TILT_ENGINE
+// Zone of the reading in accel
+int Get_Tilt_Zone(void) {
+#if USE_TILT_CLASSIFIER
+	return classify_tilt_zone(accel);
+#else
+	convert_xyz_to_roll_pitch(accel, &roll, &pitch);
+	
+	if ((fabs(roll) > TILT_ZONE2_DEG) || (fabs(pitch) > TILT_ZONE2_DEG))
+		return 2;
+	else if ((fabs(roll) > TILT_ZONE1_DEG) || (fabs(pitch) > TILT_ZONE1_DEG))
+		return 1;
+	else
+		return 0;
+#endif
+}
+#endif
+
+// Warm wake: sensor kept its configuration, recover what we keep in RAM
+void Resume_Tilt(void) {
+#if USE_MMA_TILT_ENGINE
+	tilt_zone = mma_get_tilt_zone();
+#endif
+}
+
+// Read the accelerometer and flash the LED for the tilt zone. Called from the
+// main loop for each EV_SAMPLE posted by the LPTMR or MMA8451 INT pin ISR.
+void Process_Tilt(void) {
+	int num_samples = 1;
+	uint32_t start_cycles = Get_Cycles(), start_bytes = I2C_Stats.Bytes;
+	
+	SIM->SCGC5 |= SIM_SCGC5_PORTB_MASK;	
+
+#if USE_MMA_TILT_ENGINE
+		Process_Tilt_Event();
+#else
+#if USE_MMA_FIFO
+		num_samples = read_fifo_xyz(fifo_accel, MMA_FIFO_SIZE);
+		if (num_samples > 0) {
+			average_xyz(fifo_accel, num_samples, accel);
+#if USE_ACTIVITY_CONTROL
+			Update_Activity(accel, num_samples);
+#endif
+		}
+#elif USE_ASYNC_I2C
+		num_samples = read_full_xyz_wfi(accel);
+#else
+		num_samples = read_full_xyz(accel);
+#endif
+		if (num_samples > 0)
+			Show_Tilt_Zone(Get_Tilt_Zone());
+		else
+			Show_Tilt_Error();					// accel still holds the last reading: don't show it
+#endif
+
+	Tilt_Cycles = Get_Cycles() - start_cycles;
+	if (Tilt_Cycles > Tilt_Max_Cycles)
+		Tilt_Max_Cycles = Tilt_Cycles;
+	Tilt_Bus_Bytes = I2C_Stats.Bytes - start_bytes;
+	Tilt_Samples = num_samples;
+
+#if !USE_TPM_LED_PULSE			// pulse ISR still needs the port to restore the pins
+			//Delay(1);
+			SIM->SCGC5 &= ~SIM_SCGC5_PORTB_MASK; 
+#endif
+}
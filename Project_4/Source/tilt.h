@@ -0,0 +1,36 @@
+#ifndef TILT_H
+#define TILT_H
+#include <stdint.h>
+
+// Tilt zone boundaries, degrees of roll or pitch
+#define TILT_ZONE1_DEG (15)
+#define TILT_ZONE2_DEG (30)
+
+// tan^2 of an angle in degrees as a Q24 constant, folded at compile time.
+// Taylor series for sin and cos in Horner form, accurate to 1e-9 up to 45 deg.
+#define TILT_RAD(d) ((d)*0.017453292519943295)
+#define TILT_SIN(x) ((x)*(1 - (x)*(x)/6*(1 - (x)*(x)/20*(1 - (x)*(x)/42*(1 - (x)*(x)/72*(1 - (x)*(x)/110))))))
+#define TILT_COS(x) (1 - (x)*(x)/2*(1 - (x)*(x)/12*(1 - (x)*(x)/30*(1 - (x)*(x)/56*(1 - (x)*(x)/90*(1 - (x)*(x)/132))))))
+#define TILT_TAN(d) (TILT_SIN(TILT_RAD(d))/TILT_COS(TILT_RAD(d)))
+#define TAN2_Q24(d) ((uint32_t) (TILT_TAN(d)*TILT_TAN(d)*16777216.0 + 0.5))
+#define TAN2_Q16(d) ((uint32_t) (TILT_TAN(d)*TILT_TAN(d)*65536.0 + 0.5))
+
+#define TILT_TAN2_ZONE1 TAN2_Q24(TILT_ZONE1_DEG)
+#define TILT_TAN2_ZONE2 TAN2_Q24(TILT_ZONE2_DEG)
+#define TILT_TAN2_ZONE1_Q16 TAN2_Q16(TILT_ZONE1_DEG)
+#define TILT_TAN2_ZONE2_Q16 TAN2_Q16(TILT_ZONE2_DEG)
+
+void Process_Tilt(void);
+void Resume_Tilt(void);
+int Get_Tilt_Zone(void);
+void Show_Tilt_Zone(int zone);
+void Show_Tilt_Error(void);
+int classify_tilt_zone(int16_t acc[3]);
+
+extern int16_t accel[3];
+extern float roll, pitch;
+extern uint32_t Tilt_Bus_Bytes, Tilt_Cycles, Tilt_Max_Cycles;
+extern int Tilt_Samples;
+extern uint32_t Tilt_Errors;
+
+#endif